@@ -0,0 +1,4 @@
+#!/bin/bash
+# builds and runs one of the benchmarks in bench/, e.g. ./bench.sh alloc
+NAME=${1:?usage: ./bench.sh <name> [args...]}
+g++ bench/$NAME.cpp -O3 -Wall -Wextra -ldl -lpthread -o bench_$NAME -std=c++17 && ./bench_$NAME "${@:2}"
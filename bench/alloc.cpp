@@ -0,0 +1,61 @@
+// heap allocations per call on the script call paths, counted by replacing the
+// global operator new. run with ./bench.sh alloc
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+
+#include "../chaiscript/chaiscript.hpp"
+
+static std::atomic<std::size_t> allocations{0};
+
+// kept out of line: inlined, gcc sees the malloc and free through them and warns about
+// every new and delete as a mismatched pair
+[[gnu::noinline]] void* operator new(std::size_t n) {
+    ++allocations;
+    if (void* p = std::malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int add2(int a, int b) {
+    return a + b;
+}
+
+template <class F>
+void measure(const char* name, int n, F f) {
+    // the first call fills caches that later calls reuse
+    f();
+    const std::size_t before = allocations;
+    for (int i = 0; i < n; i++) {
+        f();
+    }
+    std::cout << name << ": " << double(allocations - before) / n << " allocations per call\n";
+}
+
+int main() {
+    chaiscript::ChaiScript chai;
+    chai.add(chaiscript::fun(&add2), "add2");
+    chai.eval("def first(a, b) { a }");
+    chai.eval("global s1 = \"a\"; global s2 = \"b\"; global v = [1, 2, 3];");
+    auto script_fn = chai.eval<std::function<int (int, int)>>("first");
+    auto binary_op = chai.eval<std::function<chaiscript::Boxed_Value ()>>("fun() { s1 < s2 }");
+    auto native_fn = chai.eval<std::function<chaiscript::Boxed_Value ()>>("fun() { add2(1, 2) }");
+    auto index = chai.eval<std::function<chaiscript::Boxed_Value ()>>("fun() { v[1] }");
+    const int n = 100000;
+    measure("C++ -> script function (2 args)", n, [&] { script_fn(1, 2); });
+    measure("script binary op on strings", n, [&] { binary_op(); });
+    measure("script -> native function (2 args)", n, [&] { native_fn(); });
+    measure("script array index", n, [&] { index(); });
+}
@@ -0,0 +1,96 @@
+// chaiscript::Concurrent_Map against a std::unordered_map behind one mutex, from 1 to 32
+// threads, with 10% of operations writing by default. run with
+// ./bench.sh concurrent_map [operations] [write percent]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../chaiscript/dispatchkit/concurrent_map.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// what the reads found, so they can't be optimised away
+std::atomic<long> sink{0};
+
+struct Locked_Map {
+    std::mutex mutex;
+    std::unordered_map<std::string, long> map;
+
+    bool find(const std::string & key, long & value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = map.find(key);
+        if (it == map.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    void increment(const std::string & key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map[key]++;
+    }
+};
+
+// ops random reads and increments of 100000 keys, split over threads. returns the
+// seconds taken
+template <class Map, class Increment>
+double run(Map & map, int threads, long ops, int write_percent, Increment increment) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100000; i++) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    const auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::uint64_t x = t * 7919 + 1;
+            long value;
+            long found = 0;
+            for (long i = 0; i < ops / threads; i++) {
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                const auto & key = keys[(x >> 33) % keys.size()];
+                if (static_cast<int>((x >> 20) % 100) < write_percent) {
+                    increment(map, key);
+                } else if (map.find(key, value)) {
+                    found += value;
+                }
+            }
+            sink += found;
+        });
+    }
+    for (auto & w : workers) {
+        w.join();
+    }
+    return seconds_since(start);
+}
+
+int main(int argc, char* argv[]) {
+    const long ops = argc > 1 ? std::atol(argv[1]) : 4000000;
+    const int write_percent = argc > 2 ? std::atoi(argv[2]) : 10;
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        chaiscript::Concurrent_Map<std::string, long> concurrent;
+        const double a = run(concurrent, threads, ops, write_percent, [](auto & map, const std::string & key) {
+            map.update(key, [](long v) { return v + 1; });
+        });
+        Locked_Map locked;
+        const double b = run(locked, threads, ops, write_percent, [](auto & map, const std::string & key) {
+            map.increment(key);
+        });
+        std::cout << threads << " threads: Concurrent_Map " << ops / a / 1e6 << " M ops/s, mutex "
+                  << ops / b / 1e6 << " M ops/s\n";
+    }
+}
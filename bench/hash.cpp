@@ -0,0 +1,46 @@
+// throughput of zachlisp::hash::string against std::hash<std::string>, from short keys to
+// megabyte strings. run with ./bench.sh hash
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "../hash.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// hashes about 1 GB in strings of len bytes, changing the first byte each time so the
+// calls can't be hoisted out of the loop
+template <class Hash>
+double seconds(std::string & s, std::size_t reps, std::size_t & sink, Hash hash) {
+    const auto start = Clock::now();
+    for (std::size_t r = 0; r < reps; r++) {
+        s[0] = static_cast<char>(r);
+        sink += hash(s);
+    }
+    return seconds_since(start);
+}
+
+int main() {
+    const std::size_t total = std::size_t(1) << 30;
+    std::size_t sink = 0;
+    for (std::size_t len : {8, 32, 256, 4096, 1 << 20}) {
+        std::string s(len, 'x');
+        for (std::size_t i = 0; i < len; i++) {
+            s[i] = static_cast<char>(i * 131 + 7);
+        }
+        const std::size_t reps = total / len;
+        const double seeded = seconds(s, reps, sink, [](const std::string & s) { return zachlisp::hash::string(s); });
+        const double standard = seconds(s, reps, sink, std::hash<std::string>());
+        std::cout << len << " B: seeded " << total / seeded / 1e9 << " GB/s, " << seeded / reps * 1e9 << " ns"
+                  << "; std::hash " << total / standard / 1e9 << " GB/s, " << standard / reps * 1e9 << " ns\n";
+    }
+    // keeps the hashes live
+    return sink == 42 ? 1 : 0;
+}
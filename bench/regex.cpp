@@ -0,0 +1,87 @@
+// zachlisp::re against std::regex: searching 1 MiB of text, a pattern std::regex
+// backtracks on, and compiling. run with ./bench.sh regex
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <string>
+
+#include "../re.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// times finding every match of pattern in text with re, and with std::regex as well if
+// compare is set
+void find_all(const std::string & name, const std::string & pattern, const std::string & text, bool compare = true) {
+    auto start = Clock::now();
+    const auto r = zachlisp::re::compile(pattern);
+    std::size_t n = 0;
+    std::size_t from = 0;
+    while (true) {
+        const auto c = r->find(text, from);
+        if (c.empty()) {
+            break;
+        }
+        n++;
+        from = c[1] > c[0] ? c[1] : c[1] + 1;
+    }
+    const double re = ms_since(start);
+    if (!compare) {
+        std::cout << name << ", " << n << " matches: re " << re << " ms\n";
+        return;
+    }
+
+    start = Clock::now();
+    const std::regex sr(pattern);
+    const auto m = std::distance(std::sregex_iterator(text.begin(), text.end(), sr), std::sregex_iterator());
+    const double standard = ms_since(start);
+    std::cout << name << ", " << n << "/" << m << " matches: re " << re << " ms, std::regex " << standard << " ms\n";
+}
+
+int main() {
+    std::string text;
+    for (int i = 0; text.size() < (1 << 20); i++) {
+        text += "lorem ipsum dolor sit amet, call 555-" + std::to_string(1000 + i % 9000) + " now; ";
+    }
+
+    find_all("groups", "(\\d{3})-(\\d{4})", text);
+    find_all("words", "[a-z]+", text);
+    // the optional part could carry a match to the end of the text, but never does: the
+    // captures are filled in over each match only, not the rest of the text. std::regex
+    // recurses once per character of .* and runs out of stack
+    find_all("groups with an optional tail, 64 KiB", "(\\d{3})(?:.*QQQ)?", text.substr(0, 64 << 10), false);
+    find_all("one match at the end", "ne+dle|haystack", text + "needle");
+
+    for (int n : {16, 20, 24}) {
+        const std::string s(n, 'a');
+        auto start = Clock::now();
+        const bool re = !zachlisp::re::compile("(a|aa)*c")->matches(s).empty();
+        const double re_ms = ms_since(start);
+        start = Clock::now();
+        const bool standard = std::regex_match(s, std::regex("(a|aa)*c"));
+        std::cout << "(a|aa)*c on a^" << n << ", " << re << "/" << standard << ": re " << re_ms
+                  << " ms, std::regex " << ms_since(start) << " ms\n";
+    }
+
+    const std::string pattern = "(\\d{3})-(\\d{4})|[a-z]+@[a-z]+\\.com";
+    auto start = Clock::now();
+    for (int i = 0; i < 1000; i++) {
+        zachlisp::re::Regex r(pattern);
+    }
+    const double re = ms_since(start);
+    start = Clock::now();
+    for (int i = 0; i < 1000; i++) {
+        zachlisp::re::compile(pattern);
+    }
+    const double cached = ms_since(start);
+    start = Clock::now();
+    for (int i = 0; i < 1000; i++) {
+        std::regex sr(pattern);
+    }
+    std::cout << "compile x1000: re " << re << " ms, cached " << cached << " ms, std::regex " << ms_since(start) << " ms\n";
+}
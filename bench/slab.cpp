@@ -0,0 +1,84 @@
+// throughput of creating and destroying boxed values, which the slab allocator serves,
+// on several threads and across threads. run with ./bench.sh slab
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../chaiscript/chaiscript.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// makes 2n boxed values, keeping up to 256 alive at once
+void churn(int n) {
+    std::vector<chaiscript::Boxed_Value> keep;
+    keep.reserve(256);
+    for (int i = 0; i < n; i++) {
+        keep.push_back(chaiscript::Boxed_Value(i));
+        keep.push_back(chaiscript::Boxed_Value(std::string("s")));
+        if (keep.size() >= 256) {
+            keep.clear();
+        }
+    }
+}
+
+int main() {
+    const int n = 2000000;
+    for (int threads : {1, 4, 8}) {
+        const auto start = Clock::now();
+        std::vector<std::thread> running;
+        for (int t = 0; t < threads; t++) {
+            running.emplace_back(churn, n);
+        }
+        for (auto & t : running) {
+            t.join();
+        }
+        std::cout << threads << " threads: " << 2.0 * n * threads / seconds_since(start) / 1e6 << " M boxed values/s\n";
+    }
+
+    // made on one thread and freed on another, so every block changes threads
+    const int batches = 4000;
+    const int batch_size = 500;
+    std::mutex mutex;
+    std::deque<std::vector<chaiscript::Boxed_Value>> queue;
+    bool done = false;
+    const auto start = Clock::now();
+    std::thread producer([&] {
+        for (int b = 0; b < batches; b++) {
+            std::vector<chaiscript::Boxed_Value> batch;
+            batch.reserve(batch_size);
+            for (int i = 0; i < batch_size; i++) {
+                batch.emplace_back(i);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(batch));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    });
+    std::thread consumer([&] {
+        while (true) {
+            std::vector<chaiscript::Boxed_Value> batch;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty()) {
+                if (done) {
+                    break;
+                }
+                continue;
+            }
+            batch = std::move(queue.front());
+            queue.pop_front();
+        }
+    });
+    producer.join();
+    consumer.join();
+    std::cout << "across threads: " << double(batches) * batch_size / seconds_since(start) / 1e6 << " M boxed values/s\n";
+}
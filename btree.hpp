@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace zachlisp {
+
+    // zachlisp::btree
+    // persistent B+ tree: every update copies only the nodes on the path to the changed
+    // entry and shares the rest with the tree it came from. nodes are wide so lookups
+    // touch few cache lines and in-order walks read entries from contiguous arrays
+    namespace btree {
+
+    template <class K, class V, class Less>
+    class Map {
+    public:
+        // entries per leaf and children per branch
+        static const std::size_t MAX = 32;
+        static const std::size_t MIN = MAX / 2;
+
+        using Entry = std::pair<K, V>;
+
+        explicit Map(Less l = Less()) : root(std::make_shared<const Node>()), less(l) {}
+
+        std::size_t size() const {
+            return root->size;
+        }
+
+        const V* find(const K & key) const {
+            const Node* node = root.get();
+            while (!node->leaf()) {
+                node = node->children[child_index(*node, key)].get();
+            }
+            auto it = lower_bound(node->entries, key);
+            if (it != node->entries.end() && !less(key, it->first)) {
+                return &it->second;
+            }
+            return nullptr;
+        }
+
+        Map assoc(const K & key, const V & value) const {
+            auto ret = insert(root, key, value);
+            Map m(*this);
+            if (ret.right) {
+                auto branch = std::make_shared<Node>();
+                branch->keys.push_back(ret.separator);
+                branch->children = {ret.left, ret.right};
+                branch->size = ret.left->size + ret.right->size;
+                m.root = branch;
+            } else {
+                m.root = ret.left;
+            }
+            return m;
+        }
+
+        Map dissoc(const K & key) const {
+            if (!find(key)) {
+                return *this;
+            }
+            Map m(*this);
+            m.root = erase(root, key);
+            if (!m.root->leaf() && m.root->children.size() == 1) {
+                m.root = m.root->children.front();
+            }
+            return m;
+        }
+
+        // calls f on every entry in key order until it returns false
+        template <class F>
+        void for_each(F f) const {
+            walk(*root, nullptr, nullptr, f);
+        }
+
+        // calls f on the entries with lo <= key < hi in key order until it returns false,
+        // a null bound is open
+        template <class F>
+        void for_each(const K* lo, const K* hi, F f) const {
+            walk(*root, lo, hi, f);
+        }
+
+    private:
+        struct Node;
+        using NodePtr = std::shared_ptr<const Node>;
+
+        // leaves hold entries; branches hold children and, for each child but the first,
+        // the smallest key below it
+        struct Node {
+            std::vector<Entry> entries;
+            std::vector<K> keys;
+            std::vector<NodePtr> children;
+            std::size_t size = 0;
+
+            bool leaf() const {
+                return children.empty();
+            }
+        };
+
+        struct Inserted {
+            NodePtr left;
+            NodePtr right;
+            K separator;
+        };
+
+        typename std::vector<Entry>::const_iterator lower_bound(const std::vector<Entry> & entries, const K & key) const {
+            return std::lower_bound(entries.begin(), entries.end(), key, [this](const Entry & e, const K & k) { return less(e.first, k); });
+        }
+
+        std::size_t child_index(const Node & branch, const K & key) const {
+            return std::upper_bound(branch.keys.begin(), branch.keys.end(), key, less) - branch.keys.begin();
+        }
+
+        static std::size_t count(const Node & node) {
+            if (node.leaf()) {
+                return node.entries.size();
+            }
+            std::size_t n = 0;
+            for (const auto & child : node.children) {
+                n += child->size;
+            }
+            return n;
+        }
+
+        Inserted insert(const NodePtr & node, const K & key, const V & value) const {
+            auto copy = std::make_shared<Node>(*node);
+            if (copy->leaf()) {
+                auto it = copy->entries.begin() + (lower_bound(node->entries, key) - node->entries.begin());
+                if (it != copy->entries.end() && !less(key, it->first)) {
+                    it->second = value;
+                } else {
+                    copy->entries.insert(it, Entry(key, value));
+                }
+                copy->size = copy->entries.size();
+                if (copy->entries.size() <= MAX) {
+                    return Inserted{copy, nullptr, key};
+                }
+                auto right = std::make_shared<Node>();
+                right->entries.assign(copy->entries.begin() + MAX / 2, copy->entries.end());
+                copy->entries.resize(MAX / 2);
+                copy->size = copy->entries.size();
+                right->size = right->entries.size();
+                return Inserted{copy, right, right->entries.front().first};
+            }
+
+            auto i = child_index(*node, key);
+            auto ret = insert(node->children[i], key, value);
+            copy->children[i] = ret.left;
+            if (ret.right) {
+                copy->keys.insert(copy->keys.begin() + i, ret.separator);
+                copy->children.insert(copy->children.begin() + i + 1, ret.right);
+            }
+            copy->size = count(*copy);
+            if (copy->children.size() <= MAX) {
+                return Inserted{copy, nullptr, key};
+            }
+            auto right = std::make_shared<Node>();
+            const auto mid = copy->children.size() / 2;
+            auto separator = copy->keys[mid - 1];
+            right->children.assign(copy->children.begin() + mid, copy->children.end());
+            right->keys.assign(copy->keys.begin() + mid, copy->keys.end());
+            copy->children.resize(mid);
+            copy->keys.resize(mid - 1);
+            copy->size = count(*copy);
+            right->size = count(*right);
+            return Inserted{copy, right, separator};
+        }
+
+        static bool underfull(const Node & node) {
+            return node.leaf() ? node.entries.size() < MIN : node.children.size() < MIN;
+        }
+
+        // key must be present
+        NodePtr erase(const NodePtr & node, const K & key) const {
+            auto copy = std::make_shared<Node>(*node);
+            if (copy->leaf()) {
+                copy->entries.erase(copy->entries.begin() + (lower_bound(node->entries, key) - node->entries.begin()));
+                copy->size = copy->entries.size();
+                return copy;
+            }
+
+            auto i = child_index(*node, key);
+            copy->children[i] = erase(node->children[i], key);
+            if (underfull(*copy->children[i]) && copy->children.size() > 1) {
+                rebalance(*copy, i == 0 ? 0 : i - 1);
+            }
+            copy->size = count(*copy);
+            return copy;
+        }
+
+        // merges children i and i + 1 of branch, or shares their contents evenly if they don't fit in one node
+        static void rebalance(Node & branch, std::size_t i) {
+            const auto & l = *branch.children[i];
+            const auto & r = *branch.children[i + 1];
+            auto left = std::make_shared<Node>();
+            auto right = std::make_shared<Node>();
+
+            if (l.leaf()) {
+                std::vector<Entry> all(l.entries);
+                all.insert(all.end(), r.entries.begin(), r.entries.end());
+                if (all.size() <= MAX) {
+                    left->entries = std::move(all);
+                    right = nullptr;
+                } else {
+                    left->entries.assign(all.begin(), all.begin() + all.size() / 2);
+                    right->entries.assign(all.begin() + all.size() / 2, all.end());
+                    branch.keys[i] = right->entries.front().first;
+                }
+            } else {
+                std::vector<NodePtr> children(l.children);
+                children.insert(children.end(), r.children.begin(), r.children.end());
+                std::vector<K> keys(l.keys);
+                keys.push_back(branch.keys[i]);
+                keys.insert(keys.end(), r.keys.begin(), r.keys.end());
+                if (children.size() <= MAX) {
+                    left->children = std::move(children);
+                    left->keys = std::move(keys);
+                    right = nullptr;
+                } else {
+                    const auto mid = children.size() / 2;
+                    left->children.assign(children.begin(), children.begin() + mid);
+                    left->keys.assign(keys.begin(), keys.begin() + mid - 1);
+                    right->children.assign(children.begin() + mid, children.end());
+                    right->keys.assign(keys.begin() + mid, keys.end());
+                    branch.keys[i] = keys[mid - 1];
+                }
+            }
+
+            left->size = count(*left);
+            branch.children[i] = left;
+            if (right) {
+                right->size = count(*right);
+                branch.children[i + 1] = right;
+            } else {
+                branch.children.erase(branch.children.begin() + i + 1);
+                branch.keys.erase(branch.keys.begin() + i);
+            }
+        }
+
+        template <class F>
+        bool walk(const Node & node, const K* lo, const K* hi, F & f) const {
+            if (node.leaf()) {
+                auto it = lo ? lower_bound(node.entries, *lo) : node.entries.begin();
+                for (; it != node.entries.end(); ++it) {
+                    if (hi && !less(it->first, *hi)) {
+                        return false;
+                    }
+                    if (!f(*it)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            for (auto i = lo ? child_index(node, *lo) : 0; i < node.children.size(); i++) {
+                if (hi && i > 0 && !less(node.keys[i - 1], *hi)) {
+                    return false;
+                }
+                if (!walk(*node.children[i], lo, hi, f)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        NodePtr root;
+        Less less;
+    };
+
+    }
+
+}
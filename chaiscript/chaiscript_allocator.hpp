@@ -0,0 +1,515 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_ALLOCATOR_HPP_
+#define CHAISCRIPT_ALLOCATOR_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+
+/// \file
+/// Size-class slab allocator used for the small objects ChaiScript creates on every
+/// evaluation step: Boxed_Value data, Any holders and proxy function objects.
+///
+/// Each thread keeps a free list per size class and allocates and frees without
+/// locking. A block may be freed on a different thread than the one that allocated it;
+/// it then simply joins the freeing thread's list. Lists that grow past a limit, and the
+/// lists of exiting threads, are handed back to a process-wide pool that other threads
+/// refill from. Slab memory is never returned to the system.
+///
+/// Define CHAISCRIPT_NO_SLAB_ALLOCATOR to route every request to the global operator new.
+///
+/// Allocations made through Slab_Allocator and Any are also charged to the Memory_Quota
+/// active on the current thread, if any, which lets an engine cap its memory use, and
+/// are tallied per thread in Allocation_Counter for benchmarks and sampling profilers.
+
+namespace chaiscript
+{
+  namespace exception
+  {
+    /// \brief Thrown when an allocation would take an engine past its memory limit
+    ///
+    /// \sa chaiscript::ChaiScript_Basic::set_memory_limit
+    class memory_limit_error : public std::bad_alloc
+    {
+      public:
+        memory_limit_error() = default;
+        memory_limit_error(const memory_limit_error &) = default;
+        ~memory_limit_error() noexcept override = default;
+
+        const char *what() const noexcept override
+        {
+          return "Memory limit exceeded";
+        }
+    };
+  }
+
+  namespace detail
+  {
+    /// Byte counter with a hard cap, charged by the allocations made while it is the
+    /// current quota of a thread (see Memory_Quota::Scope).
+    ///
+    /// Every charged object remembers its quota and releases to it when freed, whichever
+    /// thread frees it. The quota therefore stays alive until its owner has detached and
+    /// the last charged byte has been released; the owner counts as one extra byte so a
+    /// single atomic counter decides when that happens.
+    class Memory_Quota
+    {
+      public:
+        /// Makes t_quota the current quota of this thread for the lifetime of the Scope
+        class Scope
+        {
+          public:
+            explicit Scope(Memory_Quota *t_quota) noexcept
+              : m_previous(current())
+            {
+              current() = t_quota;
+            }
+
+            Scope(Scope &&t_other) noexcept
+              : m_previous(t_other.m_previous), m_active(t_other.m_active)
+            {
+              t_other.m_active = false;
+            }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+            Scope &operator=(Scope &&) = delete;
+
+            ~Scope()
+            {
+              if (m_active) {
+                current() = m_previous;
+              }
+            }
+
+          private:
+            Memory_Quota *m_previous;
+            bool m_active = true;
+        };
+
+        /// Releases the owner's reference, see Memory_Quota
+        struct Detach
+        {
+          void operator()(Memory_Quota *t_quota) const noexcept
+          {
+            t_quota->release(1);
+          }
+        };
+
+        static std::unique_ptr<Memory_Quota, Detach> create(const std::size_t t_limit)
+        {
+          return std::unique_ptr<Memory_Quota, Detach>(new Memory_Quota(t_limit));
+        }
+
+        static Memory_Quota *&current() noexcept
+        {
+          static thread_local Memory_Quota *quota = nullptr;
+          return quota;
+        }
+
+        void set_limit(const std::size_t t_limit) noexcept
+        {
+          m_limit.store(t_limit, std::memory_order_relaxed);
+        }
+
+        std::size_t limit() const noexcept
+        {
+          return m_limit.load(std::memory_order_relaxed);
+        }
+
+        std::size_t used() const noexcept
+        {
+          return m_used.load(std::memory_order_relaxed) - 1;
+        }
+
+        void charge(const std::size_t t_bytes)
+        {
+          const auto used = m_used.fetch_add(t_bytes, std::memory_order_relaxed) - 1 + t_bytes;
+          if (used > m_limit.load(std::memory_order_relaxed)) {
+            release(t_bytes);
+            throw exception::memory_limit_error();
+          }
+        }
+
+        void release(const std::size_t t_bytes) noexcept
+        {
+          if (m_used.fetch_sub(t_bytes, std::memory_order_acq_rel) == t_bytes) {
+            delete this;
+          }
+        }
+
+      private:
+        explicit Memory_Quota(const std::size_t t_limit)
+          : m_limit(t_limit)
+        {
+        }
+
+        std::atomic<std::size_t> m_used{1};
+        std::atomic<std::size_t> m_limit;
+    };
+
+    /// Running totals of the allocations made on this thread through the slab allocator.
+    /// Never reset; take the difference of two snapshots to measure a stretch of code.
+    class Allocation_Counter
+    {
+      public:
+        /// Receives the number of bytes allocated on the calling thread since its previous
+        /// sample and returns how many more bytes to allocate before the next one.
+        /// Must not throw.
+        using Sampler = std::size_t (*)(std::size_t t_bytes);
+
+        std::size_t allocations = 0;
+        std::size_t bytes = 0;
+
+        static Allocation_Counter &thread() noexcept
+        {
+          static thread_local Allocation_Counter counter;
+          return counter;
+        }
+
+        /// Installs t_sampler for all threads, nullptr turns sampling off.
+        /// The calling thread samples its next allocation; other threads notice within poll_interval bytes.
+        static void set_sampler(const Sampler t_sampler) noexcept
+        {
+          sampler().store(t_sampler, std::memory_order_relaxed);
+          thread().m_last_sample = thread().bytes;
+          thread().m_next_sample = thread().bytes;
+        }
+
+        void add(const std::size_t t_bytes) noexcept
+        {
+          ++allocations;
+          bytes += t_bytes;
+          if (bytes >= m_next_sample) {
+            // with no sampler installed, look again only after another poll_interval bytes
+            const auto s = sampler().load(std::memory_order_relaxed);
+            m_next_sample = bytes + (s ? s(bytes - m_last_sample) : poll_interval);
+            m_last_sample = bytes;
+          }
+        }
+
+      private:
+        static const std::size_t poll_interval = 64 * 1024;
+
+        static std::atomic<Sampler> &sampler() noexcept
+        {
+          static std::atomic<Sampler> s{nullptr};
+          return s;
+        }
+
+        std::size_t m_last_sample = 0;
+        std::size_t m_next_sample = 0;
+    };
+
+    namespace slab
+    {
+      static const std::size_t granularity = 16;
+      static const std::size_t max_block_size = 256;
+      static const std::size_t num_size_classes = max_block_size / granularity;
+      static const std::size_t chunk_size = 64 * 1024;
+      static const std::size_t max_cached_blocks = 1024;
+      static const std::size_t refill_batch = 64;
+
+      struct Free_Block
+      {
+        Free_Block *next;
+      };
+
+      struct Free_List
+      {
+        Free_Block *head = nullptr;
+        std::size_t count = 0;
+
+        void push(Free_Block *t_block) noexcept
+        {
+          t_block->next = head;
+          head = t_block;
+          ++count;
+        }
+
+        Free_Block *pop() noexcept
+        {
+          Free_Block *block = head;
+          head = block->next;
+          --count;
+          return block;
+        }
+
+        /// Moves up to t_max blocks to t_other
+        void move_to(Free_List &t_other, std::size_t t_max) noexcept
+        {
+          while (head != nullptr && t_max-- > 0) {
+            t_other.push(pop());
+          }
+        }
+      };
+
+      inline constexpr std::size_t size_class(const std::size_t t_bytes) noexcept
+      {
+        return (t_bytes + granularity - 1) / granularity - 1;
+      }
+
+      inline constexpr std::size_t block_size(const std::size_t t_size_class) noexcept
+      {
+        return (t_size_class + 1) * granularity;
+      }
+
+      /// Process-wide pool behind the per-thread caches
+      class Global_Pool
+      {
+        public:
+          static Global_Pool &get()
+          {
+            // never destroyed: blocks may still be freed during static destruction
+            static Global_Pool *pool = new Global_Pool();
+            return *pool;
+          }
+
+          /// Moves up to t_max blocks of the given class into t_list, carving a new chunk if the pool is empty
+          void refill(const std::size_t t_size_class, Free_List &t_list, const std::size_t t_max)
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            auto &pooled = m_lists[t_size_class];
+            if (pooled.head == nullptr) {
+              carve_chunk(t_size_class, pooled);
+            }
+            pooled.move_to(t_list, t_max);
+          }
+
+          void give_back(const std::size_t t_size_class, Free_List &t_list, const std::size_t t_max) noexcept
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            t_list.move_to(m_lists[t_size_class], t_max);
+          }
+
+        private:
+          Global_Pool() = default;
+
+          static void carve_chunk(const std::size_t t_size_class, Free_List &t_list)
+          {
+            const auto size = block_size(t_size_class);
+            auto *chunk = static_cast<char *>(::operator new(chunk_size));
+            for (std::size_t offset = 0; offset + size <= chunk_size; offset += size) {
+              t_list.push(reinterpret_cast<Free_Block *>(chunk + offset));
+            }
+          }
+
+          std::mutex m_mutex;
+          std::array<Free_List, num_size_classes> m_lists;
+      };
+
+      class Thread_Cache
+      {
+        public:
+          Thread_Cache() = default;
+          Thread_Cache(const Thread_Cache &) = delete;
+          Thread_Cache &operator=(const Thread_Cache &) = delete;
+
+          ~Thread_Cache()
+          {
+            for (std::size_t i = 0; i < num_size_classes; ++i) {
+              Global_Pool::get().give_back(i, m_lists[i], m_lists[i].count);
+            }
+            state() = State::destroyed;
+          }
+
+          /// \returns this thread's cache, or nullptr once the thread is shutting down
+          static Thread_Cache *get() noexcept
+          {
+            if (state() == State::alive) {
+              return &instance();
+            } else if (state() == State::uninitialized) {
+              state() = State::alive;
+              return &instance();
+            } else {
+              return nullptr;
+            }
+          }
+
+          void *allocate(const std::size_t t_size_class)
+          {
+            auto &list = m_lists[t_size_class];
+            if (list.head == nullptr) {
+              Global_Pool::get().refill(t_size_class, list, refill_batch);
+            }
+            return list.pop();
+          }
+
+          void deallocate(void *t_ptr, const std::size_t t_size_class) noexcept
+          {
+            auto &list = m_lists[t_size_class];
+            list.push(static_cast<Free_Block *>(t_ptr));
+            if (list.count > max_cached_blocks) {
+              Global_Pool::get().give_back(t_size_class, list, max_cached_blocks / 2);
+            }
+          }
+
+        private:
+          enum class State { uninitialized, alive, destroyed };
+
+          static State &state() noexcept
+          {
+            static thread_local State s = State::uninitialized;
+            return s;
+          }
+
+          static Thread_Cache &instance()
+          {
+            static thread_local Thread_Cache cache;
+            return cache;
+          }
+
+          std::array<Free_List, num_size_classes> m_lists;
+      };
+
+      inline bool use_slab(const std::size_t t_bytes, const std::size_t t_alignment) noexcept
+      {
+#ifdef CHAISCRIPT_NO_SLAB_ALLOCATOR
+        (void)t_bytes;
+        (void)t_alignment;
+        return false;
+#else
+        // blocks sit at multiples of granularity inside chunks aligned for std::max_align_t
+        return t_bytes != 0 && t_bytes <= max_block_size
+          && t_alignment <= granularity && t_alignment <= alignof(std::max_align_t);
+#endif
+      }
+
+      /// The global operator new, in its aligned form for over-aligned types, for the
+      /// requests the slabs don't take. Class-level operator new is only ever handed the
+      /// size, so the alignment has to be passed on by hand.
+      inline void *allocate_unpooled(const std::size_t t_bytes, const std::size_t t_alignment)
+      {
+        if (t_alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+          return ::operator new(t_bytes, std::align_val_t(t_alignment));
+        }
+        return ::operator new(t_bytes);
+      }
+
+      inline void deallocate_unpooled(void *t_ptr, const std::size_t t_alignment) noexcept
+      {
+        if (t_alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+          ::operator delete(t_ptr, std::align_val_t(t_alignment));
+        } else {
+          ::operator delete(t_ptr);
+        }
+      }
+
+      inline void *allocate(const std::size_t t_bytes, const std::size_t t_alignment = alignof(std::max_align_t))
+      {
+        Allocation_Counter::thread().add(t_bytes);
+
+        if (!use_slab(t_bytes, t_alignment)) {
+          return allocate_unpooled(t_bytes, t_alignment);
+        }
+
+        const auto cls = size_class(t_bytes);
+        if (auto *cache = Thread_Cache::get()) {
+          return cache->allocate(cls);
+        }
+
+        Free_List list;
+        Global_Pool::get().refill(cls, list, 1);
+        return list.pop();
+      }
+
+      inline void deallocate(void *t_ptr, const std::size_t t_bytes, const std::size_t t_alignment = alignof(std::max_align_t)) noexcept
+      {
+        if (t_ptr == nullptr) {
+          return;
+        }
+
+        if (!use_slab(t_bytes, t_alignment)) {
+          deallocate_unpooled(t_ptr, t_alignment);
+          return;
+        }
+
+        const auto cls = size_class(t_bytes);
+        if (auto *cache = Thread_Cache::get()) {
+          cache->deallocate(t_ptr, cls);
+        } else {
+          Free_List list;
+          list.push(static_cast<Free_Block *>(t_ptr));
+          Global_Pool::get().give_back(cls, list, 1);
+        }
+      }
+    }
+
+    /// Standard allocator over the slab size classes, for use with std::allocate_shared.
+    /// Captures the thread's current Memory_Quota when constructed and charges it.
+    template<typename T>
+    class Slab_Allocator
+    {
+      public:
+        using value_type = T;
+
+        Slab_Allocator() noexcept
+          : m_quota(Memory_Quota::current())
+        {
+        }
+
+        template<typename U>
+        Slab_Allocator(const Slab_Allocator<U> &t_other) noexcept
+          : m_quota(t_other.quota())
+        {
+        }
+
+        T *allocate(const std::size_t t_n)
+        {
+          if (!m_quota) {
+            return static_cast<T *>(slab::allocate(t_n * sizeof(T), alignof(T)));
+          }
+          m_quota->charge(t_n * sizeof(T));
+          try {
+            return static_cast<T *>(slab::allocate(t_n * sizeof(T), alignof(T)));
+          } catch (...) {
+            m_quota->release(t_n * sizeof(T));
+            throw;
+          }
+        }
+
+        void deallocate(T *t_ptr, const std::size_t t_n) noexcept
+        {
+          slab::deallocate(t_ptr, t_n * sizeof(T), alignof(T));
+          if (m_quota) {
+            m_quota->release(t_n * sizeof(T));
+          }
+        }
+
+        Memory_Quota *quota() const noexcept
+        {
+          return m_quota;
+        }
+
+        template<typename U>
+        bool operator==(const Slab_Allocator<U> &t_other) const noexcept
+        {
+          return m_quota == t_other.quota();
+        }
+
+        template<typename U>
+        bool operator!=(const Slab_Allocator<U> &t_other) const noexcept
+        {
+          return m_quota != t_other.quota();
+        }
+
+      private:
+        Memory_Quota *m_quota;
+    };
+  }
+}
+
+#endif
@@ -74,6 +74,8 @@ static_assert(_MSC_FULL_VER >= 190024210, "Visual C++ 2015 Update 3 or later req
 #include <string>
 #include <cmath>
 
+#include "chaiscript_allocator.hpp"
+
 namespace chaiscript {
   static const int version_major = 6;
   static const int version_minor = 1;
@@ -89,7 +91,7 @@ namespace chaiscript {
 #ifdef CHAISCRIPT_USE_STD_MAKE_SHARED
     return std::make_shared<D>(std::forward<Arg>(arg)...);
 #else
-    return std::shared_ptr<B>(static_cast<B*>(new D(std::forward<Arg>(arg)...)));
+    return std::allocate_shared<D>(detail::Slab_Allocator<D>(), std::forward<Arg>(arg)...);
 #endif
   }
 
@@ -29,6 +29,7 @@
 
 #ifndef CHAISCRIPT_NO_THREADS
 #include <future>
+#include "dispatchkit/concurrent_map.hpp"
 #endif
 
 
@@ -55,6 +56,7 @@ namespace chaiscript
 #ifndef CHAISCRIPT_NO_THREADS
         bootstrap::standard_library::future_type<std::future<chaiscript::Boxed_Value>>("future", *lib);
         lib->add(chaiscript::fun([](const std::function<chaiscript::Boxed_Value ()> &t_func){ return std::async(std::launch::async, t_func);}), "async");
+        bootstrap::standard_library::concurrent_map_type<Concurrent_Map<std::string, Boxed_Value> >("ConcurrentMap", *lib);
 #endif
 
         json_wrap::library(*lib);
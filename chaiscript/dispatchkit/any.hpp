@@ -9,6 +9,8 @@
 
 #include <utility>
 
+#include "../chaiscript_allocator.hpp"
+
 namespace chaiscript {
   namespace detail {
     namespace exception
@@ -61,6 +63,7 @@ namespace chaiscript {
 
           virtual std::unique_ptr<Data> clone() const = 0;
           const std::type_info &m_type;
+          Memory_Quota * const m_quota = Memory_Quota::current();
         };
 
         template<typename T>
@@ -70,6 +73,16 @@ namespace chaiscript {
               : Data(typeid(T)),
                 m_data(std::move(t_type))
             {
+              if (this->m_quota) {
+                this->m_quota->charge(sizeof(Data_Impl));
+              }
+            }
+
+            ~Data_Impl() override
+            {
+              if (this->m_quota) {
+                this->m_quota->release(sizeof(Data_Impl));
+              }
             }
 
             void *data() override
@@ -84,6 +97,16 @@ namespace chaiscript {
 
             Data_Impl &operator=(const Data_Impl&) = delete;
 
+            static void *operator new(std::size_t t_size)
+            {
+              return slab::allocate(t_size, alignof(Data_Impl));
+            }
+
+            static void operator delete(void *t_ptr, std::size_t t_size) noexcept
+            {
+              slab::deallocate(t_ptr, t_size, alignof(Data_Impl));
+            }
+
             T m_data;
           };
 
@@ -577,6 +577,57 @@ namespace chaiscript
         }
 
 
+      /// Add a Concurrent_Map. It hands out copies of values rather than references, so
+      /// it gets get and insert_or_assign in place of [] and insert_ref, and update and
+      /// compute_if_absent for read-modify-write without a race.
+      template<typename MapType>
+        void concurrent_map_type(const std::string &type, Module& m)
+        {
+          typedef typename MapType::key_type key_type;
+          typedef typename MapType::mapped_type mapped_type;
+
+          m.add(user_type<MapType>(), type);
+          m.add(constructor<MapType ()>(), type);
+
+          m.add(fun([](const MapType &t_map, const key_type &t_key) {
+                mapped_type value;
+                if (!t_map.find(t_key, value)) {
+                  throw std::out_of_range("Map does not contain key");
+                }
+                return value;
+              }), "at");
+          m.add(fun([](const MapType &t_map, const key_type &t_key) {
+                mapped_type value;
+                t_map.find(t_key, value);
+                return value;
+              }), "get");
+          m.add(fun([](const MapType &t_map, const key_type &t_key, const mapped_type &t_default) {
+                mapped_type value;
+                return t_map.find(t_key, value) ? value : t_default;
+              }), "get");
+          m.add(fun(&MapType::contains), "contains");
+          m.add(fun(&MapType::size), "size");
+          m.add(fun(&MapType::empty), "empty");
+          m.add(fun(&MapType::snapshot), "snapshot");
+
+          m.add(fun(&MapType::insert_or_assign), "insert_or_assign");
+          m.add(fun(&MapType::erase), "erase");
+          m.add(fun([](MapType &t_map, const key_type &t_key, const std::function<mapped_type (const mapped_type &)> &t_f) {
+                return t_map.update(t_key, t_f);
+              }), "update");
+          m.add(fun([](MapType &t_map, const key_type &t_key, const std::function<mapped_type (const key_type &)> &t_f) {
+                return t_map.compute_if_absent(t_key, t_f);
+              }), "compute_if_absent");
+        }
+      template<typename MapType>
+        ModulePtr concurrent_map_type(const std::string &type)
+        {
+          auto m = std::make_shared<Module>();
+          concurrent_map_type<MapType>(type, *m);
+          return m;
+        }
+
+
       /// http://www.sgi.com/tech/stl/List.html
       template<typename ListType>
         void list_type(const std::string &type, Module& m)
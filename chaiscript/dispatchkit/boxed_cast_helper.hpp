@@ -34,8 +34,8 @@ namespace chaiscript
       }
 
     template<typename T>
-    static const T *verify_type_no_throw(const Boxed_Value &ob, const std::type_info &ti, const T *ptr) {
-      if (ob.get_type_info() == ti) {
+    static const T *verify_type_no_throw(const Boxed_Value &ob, const unsigned int t_type_id, const T *ptr) {
+      if (ob.get_type_info().type_id() == t_type_id) {
         return ptr;
       } else {
         throw chaiscript::detail::exception::bad_any_cast();
@@ -43,8 +43,8 @@ namespace chaiscript
     }
 
     template<typename T>
-    static T *verify_type_no_throw(const Boxed_Value &ob, const std::type_info &ti, T *ptr) {
-      if (!ob.is_const() && ob.get_type_info() == ti) {
+    static T *verify_type_no_throw(const Boxed_Value &ob, const unsigned int t_type_id, T *ptr) {
+      if (!ob.is_const() && ob.get_type_info().type_id() == t_type_id) {
         return ptr;
       } else {
         throw chaiscript::detail::exception::bad_any_cast();
@@ -53,8 +53,8 @@ namespace chaiscript
 
 
     template<typename T>
-    static const T *verify_type(const Boxed_Value &ob, const std::type_info &ti, const T *ptr) {
-      if (ob.get_type_info().bare_equal_type_info(ti)) {
+    static const T *verify_type(const Boxed_Value &ob, const unsigned int t_type_id, const T *ptr) {
+      if (ob.get_type_info().bare_type_id() == t_type_id) {
         return throw_if_null(ptr);
       } else {
         throw chaiscript::detail::exception::bad_any_cast();
@@ -62,8 +62,8 @@ namespace chaiscript
     }
 
     template<typename T>
-    static T *verify_type(const Boxed_Value &ob, const std::type_info &ti, T *ptr) {
-      if (!ob.is_const() && ob.get_type_info().bare_equal_type_info(ti)) {
+    static T *verify_type(const Boxed_Value &ob, const unsigned int t_type_id, T *ptr) {
+      if (!ob.is_const() && ob.get_type_info().bare_type_id() == t_type_id) {
         return throw_if_null(ptr);
       } else {
         throw chaiscript::detail::exception::bad_any_cast();
@@ -76,7 +76,7 @@ namespace chaiscript
       {
         static Result cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return *static_cast<const Result *>(verify_type(ob, typeid(Result), ob.get_const_ptr()));
+          return *static_cast<const Result *>(verify_type(ob, type_id<Result>(), ob.get_const_ptr()));
         }
       };
 
@@ -92,7 +92,7 @@ namespace chaiscript
       {
         static const Result * cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return static_cast<const Result *>(verify_type_no_throw(ob, typeid(Result), ob.get_const_ptr()));
+          return static_cast<const Result *>(verify_type_no_throw(ob, type_id<Result>(), ob.get_const_ptr()));
         }
       };
 
@@ -102,7 +102,7 @@ namespace chaiscript
       {
         static Result * cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return static_cast<Result *>(verify_type_no_throw(ob, typeid(Result), ob.get_ptr()));
+          return static_cast<Result *>(verify_type_no_throw(ob, type_id<Result>(), ob.get_ptr()));
         }
       };
 
@@ -123,7 +123,7 @@ namespace chaiscript
       {
         static const Result & cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return *static_cast<const Result *>(verify_type(ob, typeid(Result), ob.get_const_ptr()));
+          return *static_cast<const Result *>(verify_type(ob, type_id<Result>(), ob.get_const_ptr()));
         }
       };
 
@@ -135,7 +135,7 @@ namespace chaiscript
       {
         static Result& cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return *static_cast<Result *>(verify_type(ob, typeid(Result), ob.get_ptr()));
+          return *static_cast<Result *>(verify_type(ob, type_id<Result>(), ob.get_ptr()));
         }
       };
 
@@ -145,7 +145,7 @@ namespace chaiscript
       {
         static Result&& cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return std::move(*static_cast<Result *>(verify_type(ob, typeid(Result), ob.get_ptr())));
+          return std::move(*static_cast<Result *>(verify_type(ob, type_id<Result>(), ob.get_ptr())));
         }
       };
 
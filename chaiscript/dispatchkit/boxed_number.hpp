@@ -111,49 +111,49 @@ namespace chaiscript
       {
         const Type_Info &inp_ = t_bv.get_type_info();
 
-        if (inp_ == typeid(int)) {
+        if (inp_ == user_type<int>()) {
           return get_common_type(sizeof(int), true);
-        } else if (inp_ == typeid(double)) {
+        } else if (inp_ == user_type<double>()) {
           return Common_Types::t_double;
-        } else if (inp_ == typeid(long double)) {
+        } else if (inp_ == user_type<long double>()) {
           return Common_Types::t_long_double;
-        } else if (inp_ == typeid(float)) {
+        } else if (inp_ == user_type<float>()) {
           return Common_Types::t_float;
-        } else if (inp_ == typeid(char)) {
+        } else if (inp_ == user_type<char>()) {
           return get_common_type(sizeof(char), std::is_signed<char>::value);
-        } else if (inp_ == typeid(unsigned char)) {
+        } else if (inp_ == user_type<unsigned char>()) {
           return get_common_type(sizeof(unsigned char), false);
-        } else if (inp_ == typeid(unsigned int)) {
+        } else if (inp_ == user_type<unsigned int>()) {
           return get_common_type(sizeof(unsigned int), false);
-        } else if (inp_ == typeid(long)) {
+        } else if (inp_ == user_type<long>()) {
           return get_common_type(sizeof(long), true);
-        } else if (inp_ == typeid(long long)) {
+        } else if (inp_ == user_type<long long>()) {
           return get_common_type(sizeof(long long), true);
-        } else if (inp_ == typeid(unsigned long)) {
+        } else if (inp_ == user_type<unsigned long>()) {
           return get_common_type(sizeof(unsigned long), false);
-        } else if (inp_ == typeid(unsigned long long)) {
+        } else if (inp_ == user_type<unsigned long long>()) {
           return get_common_type(sizeof(unsigned long long), false);
-        } else if (inp_ == typeid(std::int8_t)) {
+        } else if (inp_ == user_type<std::int8_t>()) {
           return Common_Types::t_int8;
-        } else if (inp_ == typeid(std::int16_t)) {
+        } else if (inp_ == user_type<std::int16_t>()) {
           return Common_Types::t_int16;
-        } else if (inp_ == typeid(std::int32_t)) {
+        } else if (inp_ == user_type<std::int32_t>()) {
           return Common_Types::t_int32;
-        } else if (inp_ == typeid(std::int64_t)) {
+        } else if (inp_ == user_type<std::int64_t>()) {
           return Common_Types::t_int64;
-        } else if (inp_ == typeid(std::uint8_t)) {
+        } else if (inp_ == user_type<std::uint8_t>()) {
           return Common_Types::t_uint8;
-        } else if (inp_ == typeid(std::uint16_t)) {
+        } else if (inp_ == user_type<std::uint16_t>()) {
           return Common_Types::t_uint16;
-        } else if (inp_ == typeid(std::uint32_t)) {
+        } else if (inp_ == user_type<std::uint32_t>()) {
           return Common_Types::t_uint32;
-        } else if (inp_ == typeid(std::uint64_t)) {
+        } else if (inp_ == user_type<std::uint64_t>()) {
           return Common_Types::t_uint64;
-        } else if (inp_ == typeid(wchar_t)) {
+        } else if (inp_ == user_type<wchar_t>()) {
           return get_common_type(sizeof(wchar_t), std::is_signed<wchar_t>::value);
-        } else if (inp_ == typeid(char16_t)) {
+        } else if (inp_ == user_type<char16_t>()) {
           return get_common_type(sizeof(char16_t), std::is_signed<char16_t>::value);
-        } else if (inp_ == typeid(char32_t)) {
+        } else if (inp_ == user_type<char32_t>()) {
           return get_common_type(sizeof(char32_t), std::is_signed<char32_t>::value);
         } else  {
           throw chaiscript::detail::exception::bad_any_cast();
@@ -529,11 +529,11 @@ namespace chaiscript
       {
         const Type_Info &inp_ = t_bv.get_type_info();
 
-        if (inp_ == typeid(double)) {
+        if (inp_ == user_type<double>()) {
           return true;
-        } else if (inp_ == typeid(long double)) {
+        } else if (inp_ == user_type<long double>()) {
           return true;
-        } else if (inp_ == typeid(float)) {
+        } else if (inp_ == user_type<float>()) {
           return true;
         } else {
           return false;
@@ -542,49 +542,49 @@ namespace chaiscript
 
       Boxed_Number get_as(const Type_Info &inp_) const
       {
-        if (inp_.bare_equal_type_info(typeid(int))) {
+        if (inp_.bare_equal(user_type<int>())) {
           return Boxed_Number(get_as<int>());
-        } else if (inp_.bare_equal_type_info(typeid(double))) {
+        } else if (inp_.bare_equal(user_type<double>())) {
           return Boxed_Number(get_as<double>());
-        } else if (inp_.bare_equal_type_info(typeid(float))) {
+        } else if (inp_.bare_equal(user_type<float>())) {
           return Boxed_Number(get_as<float>());
-        } else if (inp_.bare_equal_type_info(typeid(long double))) {
+        } else if (inp_.bare_equal(user_type<long double>())) {
           return Boxed_Number(get_as<long double>());
-        } else if (inp_.bare_equal_type_info(typeid(char))) {
+        } else if (inp_.bare_equal(user_type<char>())) {
           return Boxed_Number(get_as<char>());
-        } else if (inp_.bare_equal_type_info(typeid(unsigned char))) {
+        } else if (inp_.bare_equal(user_type<unsigned char>())) {
           return Boxed_Number(get_as<unsigned char>());
-        } else if (inp_.bare_equal_type_info(typeid(wchar_t))) {
+        } else if (inp_.bare_equal(user_type<wchar_t>())) {
           return Boxed_Number(get_as<wchar_t>());
-        } else if (inp_.bare_equal_type_info(typeid(char16_t))) {
+        } else if (inp_.bare_equal(user_type<char16_t>())) {
           return Boxed_Number(get_as<char16_t>());
-        } else if (inp_.bare_equal_type_info(typeid(char32_t))) {
+        } else if (inp_.bare_equal(user_type<char32_t>())) {
           return Boxed_Number(get_as<char32_t>());
-        } else if (inp_.bare_equal_type_info(typeid(unsigned int))) {
+        } else if (inp_.bare_equal(user_type<unsigned int>())) {
           return Boxed_Number(get_as<unsigned int>());
-        } else if (inp_.bare_equal_type_info(typeid(long))) {
+        } else if (inp_.bare_equal(user_type<long>())) {
           return Boxed_Number(get_as<long>());
-        } else if (inp_.bare_equal_type_info(typeid(long long))) {
+        } else if (inp_.bare_equal(user_type<long long>())) {
           return Boxed_Number(get_as<long long>());
-        } else if (inp_.bare_equal_type_info(typeid(unsigned long))) {
+        } else if (inp_.bare_equal(user_type<unsigned long>())) {
           return Boxed_Number(get_as<unsigned long>());
-        } else if (inp_.bare_equal_type_info(typeid(unsigned long long))) {
+        } else if (inp_.bare_equal(user_type<unsigned long long>())) {
           return Boxed_Number(get_as<unsigned long long>());
-        } else if (inp_.bare_equal_type_info(typeid(int8_t))) {
+        } else if (inp_.bare_equal(user_type<int8_t>())) {
           return Boxed_Number(get_as<int8_t>());
-        } else if (inp_.bare_equal_type_info(typeid(int16_t))) {
+        } else if (inp_.bare_equal(user_type<int16_t>())) {
           return Boxed_Number(get_as<int16_t>());
-        } else if (inp_.bare_equal_type_info(typeid(int32_t))) {
+        } else if (inp_.bare_equal(user_type<int32_t>())) {
           return Boxed_Number(get_as<int32_t>());
-        } else if (inp_.bare_equal_type_info(typeid(int64_t))) {
+        } else if (inp_.bare_equal(user_type<int64_t>())) {
           return Boxed_Number(get_as<int64_t>());
-        } else if (inp_.bare_equal_type_info(typeid(uint8_t))) {
+        } else if (inp_.bare_equal(user_type<uint8_t>())) {
           return Boxed_Number(get_as<uint8_t>());
-        } else if (inp_.bare_equal_type_info(typeid(uint16_t))) {
+        } else if (inp_.bare_equal(user_type<uint16_t>())) {
           return Boxed_Number(get_as<uint16_t>());
-        } else if (inp_.bare_equal_type_info(typeid(uint32_t))) {
+        } else if (inp_.bare_equal(user_type<uint32_t>())) {
           return Boxed_Number(get_as<uint32_t>());
-        } else if (inp_.bare_equal_type_info(typeid(uint64_t))) {
+        } else if (inp_.bare_equal(user_type<uint64_t>())) {
           return Boxed_Number(get_as<uint64_t>());
         } else {
           throw chaiscript::detail::exception::bad_any_cast();
@@ -716,7 +716,7 @@ namespace chaiscript
       static void validate_boxed_number(const Boxed_Value &v)
       {
         const Type_Info &inp_ = v.get_type_info();
-        if (inp_ == typeid(bool))
+        if (inp_ == user_type<bool>())
         {
           throw chaiscript::detail::exception::bad_any_cast();
         }
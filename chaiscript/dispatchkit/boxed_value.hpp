@@ -15,6 +15,7 @@
 #include <memory>
 #include <type_traits>
 
+#include "../chaiscript_allocator.hpp"
 #include "../chaiscript_defines.hpp"
 #include "any.hpp"
 #include "type_info.hpp"
@@ -83,7 +84,7 @@ namespace chaiscript
       {
         static auto get(Boxed_Value::Void_Type, bool t_return_value)
         {
-          return std::make_shared<Data>(
+          return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                 detail::Get_Type_Info<void>::get(),
                 chaiscript::detail::Any(), 
                 false,
@@ -101,7 +102,7 @@ namespace chaiscript
         template<typename T>
           static auto get(const std::shared_ptr<T> &obj, bool t_return_value)
           {
-            return std::make_shared<Data>(
+            return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(obj), 
                   false,
@@ -114,7 +115,7 @@ namespace chaiscript
           static auto get(std::shared_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(obj)), 
                   false,
@@ -142,7 +143,7 @@ namespace chaiscript
           static auto get(std::reference_wrapper<T> obj, bool t_return_value)
           {
             auto p = &obj.get();
-            return std::make_shared<Data>(
+            return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                   detail::Get_Type_Info<T>::get(),
                   chaiscript::detail::Any(std::move(obj)),
                   true,
@@ -155,7 +156,7 @@ namespace chaiscript
           static auto get(std::unique_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::make_shared<std::unique_ptr<T>>(std::move(obj))), 
                   true,
@@ -167,9 +168,11 @@ namespace chaiscript
         template<typename T>
           static auto get(T t, bool t_return_value)
           {
-            auto p = std::make_shared<T>(std::move(t));
+            // the payload comes from the slab too: Dynamic_Object and most script values
+            // are boxed by value through here
+            auto p = std::allocate_shared<T>(chaiscript::detail::Slab_Allocator<T>(), std::move(t));
             auto ptr = p.get();
-            return std::make_shared<Data>(
+            return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(p)),
                   false,
@@ -180,7 +183,7 @@ namespace chaiscript
 
         static std::shared_ptr<Data> get()
         {
-          return std::make_shared<Data>(
+          return std::allocate_shared<Data>(chaiscript::detail::Slab_Allocator<Data>(),
                 Type_Info(),
                 chaiscript::detail::Any(),
                 false,
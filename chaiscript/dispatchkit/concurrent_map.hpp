@@ -0,0 +1,485 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_CONCURRENT_MAP_HPP_
+#define CHAISCRIPT_CONCURRENT_MAP_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../utility/seeded_hash.hpp"
+
+/// \file
+/// Hash map that many threads can read and write at once, for state that scripts share
+/// between async tasks.
+///
+/// Keys are hashed with a per-process random key by default, since a map that scripts
+/// share is often filled from outside input.
+///
+/// Readers take no locks: every bucket is a chain of immutable nodes linked through
+/// atomic pointers, so a lookup only follows pointers. Writers lock one of a fixed set of
+/// stripes, chosen by the key's hash, and publish a changed entry by linking in a new
+/// node in place of the old one. Growing the table locks every stripe and builds a new
+/// table beside the old one.
+///
+/// Nodes and tables that are unlinked while readers may still be walking them are freed
+/// through epoch-based reclamation: every reader announces the global epoch on entry,
+/// the epoch only advances once no reader is still in an older one, and anything retired
+/// in epoch e is freed once the epoch has reached e + 2.
+///
+/// The callbacks given to update and compute_if_absent run while their key's stripe is
+/// locked, so the lock order is up to the caller. A callback that writes to this map, or
+/// that takes a lock some other thread holds while writing to this map (including a
+/// stripe of a second Concurrent_Map whose callbacks write back to this one), can
+/// deadlock. Compute anything that needs other locks before calling update.
+
+namespace chaiscript
+{
+  namespace detail
+  {
+    /// Process-wide epoch-based reclamation for Concurrent_Map
+    class Epoch
+    {
+        static constexpr std::uint64_t QUIESCENT = 0;
+        static constexpr std::size_t COLLECT_AT = 64;
+
+        /// A thread's announcement. Never freed: a thread that exits leaves its record
+        /// for the next new thread to take over.
+        struct Participant
+        {
+          std::atomic<std::uint64_t> epoch{QUIESCENT};
+          std::atomic<bool> in_use{true};
+          std::size_t depth = 0;
+          Participant *next = nullptr;
+        };
+
+        struct Retired
+        {
+          void *ptr;
+          void (*deleter)(void *);
+          std::uint64_t epoch;
+        };
+
+        struct Domain
+        {
+          // starts past QUIESCENT so an announced epoch is never mistaken for it
+          std::atomic<std::uint64_t> epoch{1};
+          std::atomic<Participant *> participants{nullptr};
+          std::mutex mutex;
+          std::vector<Retired> retired;
+          std::size_t collect_at = COLLECT_AT;
+        };
+
+      public:
+        /// Marks the calling thread as reading for its lifetime; nothing retired after
+        /// the guard is created is freed until it is destroyed. Guards may nest.
+        class Guard
+        {
+          public:
+            Guard() noexcept
+              : m_participant(participant())
+            {
+              if (m_participant->depth++ == 0) {
+                m_participant->epoch.store(domain().epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                // the announcement has to be visible before this thread loads any pointer
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+              }
+            }
+
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+            ~Guard()
+            {
+              if (--m_participant->depth == 0) {
+                m_participant->epoch.store(QUIESCENT, std::memory_order_release);
+              }
+            }
+
+          private:
+            Participant *m_participant;
+        };
+
+        /// Frees t_ptr with t_deleter once no reader can still reach it. The caller must
+        /// already have unlinked it.
+        static void retire(void *t_ptr, void (*t_deleter)(void *))
+        {
+          auto &d = domain();
+          bool collect;
+          {
+            std::lock_guard<std::mutex> lock(d.mutex);
+            d.retired.push_back(Retired{t_ptr, t_deleter, d.epoch.load(std::memory_order_relaxed)});
+            collect = d.retired.size() >= d.collect_at;
+          }
+          if (collect) {
+            reclaim();
+          }
+        }
+
+        /// Advances the epoch if every reader has caught up with it, and frees what is no
+        /// longer reachable
+        static void reclaim()
+        {
+          auto &d = domain();
+          std::vector<Retired> ready;
+          {
+            std::lock_guard<std::mutex> lock(d.mutex);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto epoch = d.epoch.load(std::memory_order_relaxed);
+            bool current = true;
+            for (auto *p = d.participants.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+              const auto e = p->epoch.load(std::memory_order_acquire);
+              if (e != QUIESCENT && e != epoch) {
+                current = false;
+                break;
+              }
+            }
+            if (current) {
+              d.epoch.store(epoch + 1, std::memory_order_release);
+            }
+            const auto safe = d.epoch.load(std::memory_order_relaxed);
+            auto keep = d.retired.begin();
+            for (auto &r : d.retired) {
+              if (r.epoch + 2 <= safe) {
+                ready.push_back(r);
+              } else {
+                *keep++ = r;
+              }
+            }
+            d.retired.erase(keep, d.retired.end());
+            // with readers holding the epoch back the list can't shrink; don't rescan it
+            // on every retirement
+            d.collect_at = std::max<std::size_t>(COLLECT_AT, d.retired.size() * 2);
+          }
+          // outside the lock, since freeing a value may retire more
+          for (auto &r : ready) {
+            r.deleter(r.ptr);
+          }
+        }
+
+      private:
+        /// Never destroyed, so values still waiting to be freed at exit are left alone
+        /// rather than destroyed after the things they refer to
+        static Domain &domain() noexcept
+        {
+          static Domain *d = new Domain();
+          return *d;
+        }
+
+        struct Thread_Record
+        {
+          Participant *participant;
+
+          Thread_Record()
+            : participant(acquire())
+          {
+          }
+
+          ~Thread_Record()
+          {
+            participant->in_use.store(false, std::memory_order_release);
+          }
+        };
+
+        static Participant *participant() noexcept
+        {
+          static thread_local Thread_Record record;
+          return record.participant;
+        }
+
+        static Participant *acquire()
+        {
+          auto &d = domain();
+          for (auto *p = d.participants.load(std::memory_order_acquire); p != nullptr; p = p->next) {
+            bool expected = false;
+            if (!p->in_use.load(std::memory_order_relaxed) && p->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+              return p;
+            }
+          }
+          auto *p = new Participant();
+          p->next = d.participants.load(std::memory_order_relaxed);
+          while (!d.participants.compare_exchange_weak(p->next, p, std::memory_order_release, std::memory_order_relaxed)) {
+          }
+          return p;
+        }
+    };
+  }
+
+  /// Hash map safe to share between threads without outside locking; see the file
+  /// comment. Lookups return copies of values, and a value is never changed in place:
+  /// update, compute_if_absent and insert_or_assign replace it whole.
+  template<typename Key, typename T, typename Hash = utility::Seeded_Hash<Key>>
+    class Concurrent_Map
+    {
+      public:
+        typedef Key key_type;
+        typedef T mapped_type;
+
+        Concurrent_Map()
+          : m_table(new Table(MIN_BUCKETS))
+        {
+        }
+
+        Concurrent_Map(const Concurrent_Map &) = delete;
+        Concurrent_Map &operator=(const Concurrent_Map &) = delete;
+
+        ~Concurrent_Map()
+        {
+          Table::destroy(m_table.load(std::memory_order_relaxed));
+        }
+
+        /// Copies the value for t_key into t_value; takes no locks
+        bool find(const Key &t_key, T &t_value) const
+        {
+          detail::Epoch::Guard guard;
+          if (const auto *n = find_node(m_table.load(std::memory_order_acquire), t_key, m_hash(t_key))) {
+            t_value = n->value;
+            return true;
+          }
+          return false;
+        }
+
+        bool contains(const Key &t_key) const
+        {
+          detail::Epoch::Guard guard;
+          return find_node(m_table.load(std::memory_order_acquire), t_key, m_hash(t_key)) != nullptr;
+        }
+
+        /// Adds or replaces the value for t_key
+        void insert_or_assign(const Key &t_key, const T &t_value)
+        {
+          write(t_key, [&](const Node *) { return std::make_pair(true, t_value); });
+        }
+
+        /// Removes t_key, returning how many entries were removed
+        std::size_t erase(const Key &t_key)
+        {
+          const auto h = m_hash(t_key);
+          auto &stripe = m_stripes[h % STRIPES];
+          {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            auto *table = m_table.load(std::memory_order_relaxed);
+            auto *link = &table->bucket(h);
+            for (auto *n = link->load(std::memory_order_relaxed); n != nullptr; link = &n->next, n = link->load(std::memory_order_relaxed)) {
+              if (n->hash == h && n->key == t_key) {
+                link->store(n->next.load(std::memory_order_relaxed), std::memory_order_release);
+                stripe.size.fetch_sub(1, std::memory_order_relaxed);
+                retire(n);
+                return 1;
+              }
+            }
+          }
+          return 0;
+        }
+
+        /// Replaces the value for t_key with t_f(old value), passing a default-constructed
+        /// T when t_key is missing, and returns the new value. Atomic with respect to
+        /// every other write to t_key. t_f runs under the key's stripe lock, so it must not
+        /// write to this map or take a lock that a writer to this map may hold; see the
+        /// file comment.
+        template<typename F>
+          T update(const Key &t_key, F &&t_f)
+          {
+            return write(t_key, [&](const Node *t_old) { return std::make_pair(true, t_f(t_old ? t_old->value : T())); });
+          }
+
+        /// The value for t_key, first adding t_f(t_key) if t_key is missing. t_f is
+        /// called at most once per key, under the key's stripe lock, so it must not write
+        /// to this map or take a lock that a writer to this map may hold; see the file
+        /// comment.
+        template<typename F>
+          T compute_if_absent(const Key &t_key, F &&t_f)
+          {
+            T value;
+            if (find(t_key, value)) {
+              return value;
+            }
+            return write(t_key, [&](const Node *t_old) {
+                return t_old ? std::make_pair(false, t_old->value) : std::make_pair(true, T(t_f(t_key)));
+              });
+          }
+
+        std::size_t size() const noexcept
+        {
+          std::size_t n = 0;
+          for (const auto &stripe : m_stripes) {
+            n += stripe.size.load(std::memory_order_relaxed);
+          }
+          return n;
+        }
+
+        bool empty() const noexcept
+        {
+          return size() == 0;
+        }
+
+        /// A copy of the entries. Writes made while it is taken may or may not be in it.
+        std::map<Key, T> snapshot() const
+        {
+          std::map<Key, T> ret;
+          detail::Epoch::Guard guard;
+          const auto *table = m_table.load(std::memory_order_acquire);
+          for (std::size_t i = 0; i < table->buckets.size(); ++i) {
+            for (const auto *n = table->buckets[i].load(std::memory_order_acquire); n != nullptr; n = n->next.load(std::memory_order_acquire)) {
+              ret.emplace(n->key, n->value);
+            }
+          }
+          return ret;
+        }
+
+      private:
+        static constexpr std::size_t STRIPES = 16;
+        static constexpr std::size_t MIN_BUCKETS = 64;
+        static constexpr std::size_t LOAD_FACTOR = 2;
+
+        struct Node
+        {
+          Node(Key t_key, const std::size_t t_hash, T t_value, Node *t_next)
+            : key(std::move(t_key)), hash(t_hash), value(std::move(t_value)), next(t_next)
+          {
+          }
+
+          const Key key;
+          const std::size_t hash;
+          const T value;
+          std::atomic<Node *> next;
+        };
+
+        struct Table
+        {
+          explicit Table(const std::size_t t_size)
+            : buckets(t_size)
+          {
+          }
+
+          std::atomic<Node *> &bucket(const std::size_t t_hash)
+          {
+            // the low bits pick both the stripe and the bucket, so every key in a chain
+            // belongs to the same stripe
+            return buckets[t_hash % buckets.size()];
+          }
+
+          static void destroy(void *t_table)
+          {
+            auto *table = static_cast<Table *>(t_table);
+            for (auto &b : table->buckets) {
+              for (auto *n = b.load(std::memory_order_relaxed); n != nullptr;) {
+                auto *next = n->next.load(std::memory_order_relaxed);
+                delete n;
+                n = next;
+              }
+            }
+            delete table;
+          }
+
+          std::vector<std::atomic<Node *>> buckets;
+        };
+
+        /// Each stripe owns the keys whose hash is congruent to its index
+        struct alignas(64) Stripe
+        {
+          std::mutex mutex;
+          std::atomic<std::size_t> size{0};
+        };
+
+        static const Node *find_node(Table *t_table, const Key &t_key, const std::size_t t_hash)
+        {
+          for (const auto *n = t_table->bucket(t_hash).load(std::memory_order_acquire); n != nullptr; n = n->next.load(std::memory_order_acquire)) {
+            if (n->hash == t_hash && n->key == t_key) {
+              return n;
+            }
+          }
+          return nullptr;
+        }
+
+        static void retire(Node *t_node)
+        {
+          detail::Epoch::retire(t_node, [](void *p) { delete static_cast<Node *>(p); });
+        }
+
+        /// Under t_key's stripe lock, calls t_f with t_key's node or nullptr. t_f returns
+        /// whether to store a value and the value; the value is returned
+        template<typename F>
+          T write(const Key &t_key, F &&t_f)
+          {
+            const auto h = m_hash(t_key);
+            auto &stripe = m_stripes[h % STRIPES];
+            Table *seen;
+            T ret;
+            {
+              std::lock_guard<std::mutex> lock(stripe.mutex);
+              // the table can't be replaced while a stripe lock is held
+              seen = m_table.load(std::memory_order_relaxed);
+              auto &head = seen->bucket(h);
+              auto *link = &head;
+              auto *n = link->load(std::memory_order_relaxed);
+              while (n != nullptr && !(n->hash == h && n->key == t_key)) {
+                link = &n->next;
+                n = link->load(std::memory_order_relaxed);
+              }
+              auto result = t_f(n);
+              ret = result.second;
+              if (!result.first) {
+                return ret;
+              }
+              if (n != nullptr) {
+                link->store(new Node(n->key, h, std::move(result.second), n->next.load(std::memory_order_relaxed)), std::memory_order_release);
+                retire(n);
+                return ret;
+              }
+              head.store(new Node(t_key, h, std::move(result.second), head.load(std::memory_order_relaxed)), std::memory_order_release);
+              if (stripe.size.fetch_add(1, std::memory_order_relaxed) + 1 <= seen->buckets.size() * LOAD_FACTOR / STRIPES) {
+                return ret;
+              }
+            }
+            grow(seen);
+            return ret;
+          }
+
+        /// Doubles the table unless another thread already replaced t_seen. Readers keep
+        /// using the old table and its nodes until they are retired, so every entry is
+        /// copied rather than moved.
+        void grow(Table *t_seen)
+        {
+          std::array<std::unique_lock<std::mutex>, STRIPES> locks;
+          for (std::size_t i = 0; i < STRIPES; ++i) {
+            locks[i] = std::unique_lock<std::mutex>(m_stripes[i].mutex);
+          }
+          auto *old = m_table.load(std::memory_order_relaxed);
+          if (old != t_seen) {
+            return;
+          }
+          auto *table = new Table(old->buckets.size() * 2);
+          for (auto &b : old->buckets) {
+            for (auto *n = b.load(std::memory_order_relaxed); n != nullptr; n = n->next.load(std::memory_order_relaxed)) {
+              auto &to = table->bucket(n->hash);
+              to.store(new Node(n->key, n->hash, n->value, to.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            }
+          }
+          m_table.store(table, std::memory_order_release);
+          detail::Epoch::retire(old, &Table::destroy);
+        }
+
+        Hash m_hash;
+        std::atomic<Table *> m_table;
+        std::array<Stripe, STRIPES> m_stripes;
+    };
+}
+
+#endif
@@ -12,6 +12,7 @@
 #define CHAISCRIPT_DISPATCHKIT_HPP_
 
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include <list>
 #include <map>
@@ -31,6 +32,7 @@
 #include "boxed_value.hpp"
 #include "type_conversions.hpp"
 #include "dynamic_object.hpp"
+#include "function_params.hpp"
 #include "proxy_constructors.hpp"
 #include "proxy_functions.hpp"
 #include "type_info.hpp"
@@ -253,7 +255,7 @@ namespace chaiscript
         {
           while (begin != end)
           {
-            t.eval(*begin);
+            t.eval_module_script(*begin);
             ++begin;
           }
         }
@@ -291,6 +293,12 @@ namespace chaiscript
           return std::vector<Const_Proxy_Function>(m_funcs.begin(), m_funcs.end());
         }
 
+        bool is_pure() const override
+        {
+          return !m_funcs.empty() && std::all_of(std::begin(m_funcs), std::end(m_funcs),
+                                                 [](const Proxy_Function &f){ return f->is_pure(); });
+        }
+
 
         static int calculate_arity(const std::vector<Proxy_Function> &t_funcs)
         {
@@ -312,14 +320,14 @@ namespace chaiscript
           return arity;
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return std::any_of(std::begin(m_funcs), std::end(m_funcs),
                              [&vals, &t_conversions](const Proxy_Function &f){ return f->call_match(vals, t_conversions); });
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return dispatch::dispatch(m_funcs, params, t_conversions);
         }
@@ -935,7 +943,7 @@ namespace chaiscript
           return m_conversions;
         }
 
-        static bool is_attribute_call(const std::vector<Proxy_Function> &t_funs, const std::vector<Boxed_Value> &t_params,
+        static bool is_attribute_call(const std::vector<Proxy_Function> &t_funs, const Function_Params &t_params,
             bool t_has_params, const Type_Conversions_State &t_conversions)
         {
           if (!t_has_params || t_params.empty()) {
@@ -956,7 +964,7 @@ namespace chaiscript
 #pragma warning(push)
 #pragma warning(disable : 4715)
 #endif
-        Boxed_Value call_member(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params, bool t_has_params,
+        Boxed_Value call_member(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const Function_Params &params, bool t_has_params,
                                 const Type_Conversions_State &t_conversions)
         {
           uint_fast32_t loc = t_loc;
@@ -964,10 +972,9 @@ namespace chaiscript
           if (funs.first != loc) { t_loc = uint_fast32_t(funs.first); }
 
           const auto do_attribute_call =
-            [this](int l_num_params, const std::vector<Boxed_Value> &l_params, const std::vector<Proxy_Function> &l_funs, const Type_Conversions_State &l_conversions)->Boxed_Value
+            [this](int l_num_params, const Function_Params &l_params, const std::vector<Proxy_Function> &l_funs, const Type_Conversions_State &l_conversions)->Boxed_Value
             {
-              std::vector<Boxed_Value> attr_params{l_params.begin(), l_params.begin() + l_num_params};
-              Boxed_Value bv = dispatch::dispatch(l_funs, attr_params, l_conversions);
+              Boxed_Value bv = dispatch::dispatch(l_funs, Function_Params{l_params.begin(), l_params.begin() + l_num_params}, l_conversions);
               if (l_num_params < int(l_params.size()) || bv.get_type_info().bare_equal(user_type<dispatch::Proxy_Function_Base>())) {
                 struct This_Foist {
                   This_Foist(Dispatch_Engine &e, const Boxed_Value &t_bv) : m_e(e) {
@@ -987,16 +994,16 @@ namespace chaiscript
                 try {
                   auto func = boxed_cast<const dispatch::Proxy_Function_Base *>(bv);
                   try {
-                    return (*func)({l_params.begin() + l_num_params, l_params.end()}, l_conversions);
+                    return (*func)(Function_Params{l_params.begin() + l_num_params, l_params.end()}, l_conversions);
                   } catch (const chaiscript::exception::bad_boxed_cast &) {
                   } catch (const chaiscript::exception::arity_error &) {
                   } catch (const chaiscript::exception::guard_error &) {
                   }
-                  throw chaiscript::exception::dispatch_error({l_params.begin() + l_num_params, l_params.end()},
+                  throw chaiscript::exception::dispatch_error(Function_Params{l_params.begin() + l_num_params, l_params.end()},
                       std::vector<Const_Proxy_Function>{boxed_cast<Const_Proxy_Function>(bv)});
                 } catch (const chaiscript::exception::bad_boxed_cast &) {
                   // unable to convert bv into a Proxy_Function_Base
-                  throw chaiscript::exception::dispatch_error({l_params.begin() + l_num_params, l_params.end()},
+                  throw chaiscript::exception::dispatch_error(Function_Params{l_params.begin() + l_num_params, l_params.end()},
                       std::vector<Const_Proxy_Function>(l_funs.begin(), l_funs.end()));
                 }
               } else {
@@ -1049,11 +1056,12 @@ namespace chaiscript
             if (!functions.empty()) {
               try {
                 if (is_no_param) {
-                  std::vector<Boxed_Value> tmp_params(params);
+                  std::vector<Boxed_Value> tmp_params = params.to_vector();
                   tmp_params.insert(tmp_params.begin() + 1, var(t_name));
                   return do_attribute_call(2, tmp_params, functions, t_conversions);
                 } else {
-                  return dispatch::dispatch(functions, {params[0], var(t_name), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}, t_conversions);
+                  const std::array<Boxed_Value, 3> missing_params{{params[0], var(t_name), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}};
+                  return dispatch::dispatch(functions, missing_params, t_conversions);
                 }
               } catch (const dispatch::option_explicit_set &e) {
                 throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()),
@@ -1076,7 +1084,7 @@ namespace chaiscript
 
 
 
-        Boxed_Value call_function(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params,
+        Boxed_Value call_function(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const Function_Params &params,
             const Type_Conversions_State &t_conversions) const
         {
           uint_fast32_t loc = t_loc;
@@ -1125,7 +1133,7 @@ namespace chaiscript
 
         /// Returns true if a call can be made that consists of the first parameter
         /// (the function) with the remaining parameters as its arguments.
-        Boxed_Value call_exists(const std::vector<Boxed_Value> &params) const
+        Boxed_Value call_exists(const Function_Params &params) const
         {
           if (params.empty())
           {
@@ -1135,7 +1143,7 @@ namespace chaiscript
           const Const_Proxy_Function &f = this->boxed_cast<Const_Proxy_Function>(params[0]);
           const Type_Conversions_State convs(m_conversions, m_conversions.conversion_saves());
 
-          return const_var(f->call_match(std::vector<Boxed_Value>(params.begin() + 1, params.end()), convs));
+          return const_var(f->call_match(Function_Params{params.begin() + 1, params.end()}, convs));
         }
 
         /// Dump all system info to stdout
@@ -1209,7 +1217,7 @@ namespace chaiscript
           }
         }
 
-        static void save_function_params(Stack_Holder &t_s, const std::vector<Boxed_Value> &t_params)
+        static void save_function_params(Stack_Holder &t_s, const Function_Params &t_params)
         {
           t_s.call_params.back().insert(t_s.call_params.back().begin(), t_params.begin(), t_params.end());
         }
@@ -1224,7 +1232,7 @@ namespace chaiscript
           save_function_params(*m_stack_holder, std::move(t_params));
         }
 
-        void save_function_params(const std::vector<Boxed_Value> &t_params)
+        void save_function_params(const Function_Params &t_params)
         {
           save_function_params(*m_stack_holder, t_params);
         }
@@ -0,0 +1,87 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_FUNCTION_PARAMS_HPP_
+#define CHAISCRIPT_FUNCTION_PARAMS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "boxed_value.hpp"
+
+namespace chaiscript
+{
+
+  /// \brief Non-owning view over the parameters of a function call.
+  ///
+  /// Lets callers pass parameters that live on the stack (a std::array or a single
+  /// Boxed_Value) as cheaply as parameters held in a std::vector. The viewed values
+  /// must outlive the call.
+  class Function_Params
+  {
+    public:
+      Function_Params(const Boxed_Value * const t_begin, const Boxed_Value * const t_end)
+        : m_begin(t_begin), m_end(t_end)
+      {
+      }
+
+      explicit Function_Params(const Boxed_Value &bv)
+        : m_begin(&bv), m_end(m_begin + 1)
+      {
+      }
+
+      Function_Params(const std::vector<Boxed_Value> &vec)
+        : m_begin(vec.data()), m_end(vec.data() + vec.size())
+      {
+      }
+
+      template<size_t Size>
+        Function_Params(const std::array<Boxed_Value, Size> &a)
+        : m_begin(a.data()), m_end(a.data() + Size)
+      {
+      }
+
+      const Boxed_Value &operator[](const std::size_t t_i) const noexcept {
+        return m_begin[t_i];
+      }
+
+      const Boxed_Value *begin() const noexcept {
+        return m_begin;
+      }
+
+      const Boxed_Value &front() const noexcept {
+        return *m_begin;
+      }
+
+      const Boxed_Value *end() const noexcept {
+        return m_end;
+      }
+
+      std::size_t size() const noexcept {
+        return static_cast<std::size_t>(m_end - m_begin);
+      }
+
+      bool empty() const noexcept {
+        return m_begin == m_end;
+      }
+
+      std::vector<Boxed_Value> to_vector() const {
+        return std::vector<Boxed_Value>{m_begin, m_end};
+      }
+
+    private:
+      const Boxed_Value *m_begin = nullptr;
+      const Boxed_Value *m_end = nullptr;
+  };
+
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "proxy_functions_detail.hpp"
 #include "type_info.hpp"
 #include "dynamic_object.hpp"
+#include "function_params.hpp"
 
 namespace chaiscript {
 class Type_Conversions;
@@ -75,8 +76,9 @@ namespace chaiscript
           return m_types == t_rhs.m_types;
         }
 
-        std::vector<Boxed_Value> convert(std::vector<Boxed_Value> vals, const Type_Conversions_State &t_conversions) const
+        std::vector<Boxed_Value> convert(const Function_Params &t_params, const Type_Conversions_State &t_conversions) const
         {
+          auto vals = t_params.to_vector();
           for (size_t i = 0; i < vals.size(); ++i)
           {
             const auto &name = m_types[i].first;
@@ -114,7 +116,7 @@ namespace chaiscript
 
         // first result: is a match
         // second result: needs conversions
-        std::pair<bool, bool> match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        std::pair<bool, bool> match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           bool needs_conversion = false;
 
@@ -197,7 +199,7 @@ namespace chaiscript
       public:
         virtual ~Proxy_Function_Base() = default;
 
-        Boxed_Value operator()(const std::vector<Boxed_Value> &params, const chaiscript::Type_Conversions_State &t_conversions) const
+        Boxed_Value operator()(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions) const
         {
           if (m_arity < 0 || size_t(m_arity) == params.size()) {
             return do_call(params, t_conversions);
@@ -206,6 +208,10 @@ namespace chaiscript
           }
         }
 
+        /// Calls the function if the parameters can be applied to it, storing the result in t_result.
+        /// \returns false, rather than throwing, if the parameters do not match
+        virtual bool try_call(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions, Boxed_Value &t_result) const;
+
         /// Returns a vector containing all of the types of the parameters the function returns/takes
         /// if the function is variadic or takes no arguments (arity of 0 or -1), the returned
         /// value contains exactly 1 Type_Info object: the return type
@@ -213,10 +219,17 @@ namespace chaiscript
         const std::vector<Type_Info> &get_param_types() const { return m_types; }
 
         virtual bool operator==(const Proxy_Function_Base &) const = 0;
-        virtual bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const = 0;
+        virtual bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const = 0;
 
         virtual bool is_attribute_function() const { return false; }
 
+        /// \returns true if the function was registered as pure: its result depends only on
+        ///          its arguments and calling it has no side effects, so calls with constant
+        ///          arguments may be folded
+        virtual bool is_pure() const { return m_is_pure; }
+
+        void set_pure(const bool t_pure) { m_is_pure = t_pure; }
+
         bool has_arithmetic_param() const 
         {
           return m_has_arithmetic_param;
@@ -229,7 +242,7 @@ namespace chaiscript
 
         //! Return true if the function is a possible match
         //! to the passed in values
-        bool filter(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        bool filter(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           assert(m_arity == -1 || (m_arity > 0 && static_cast<int>(vals.size()) == m_arity));
 
@@ -274,7 +287,7 @@ namespace chaiscript
         }
 
       protected:
-        virtual Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const = 0;
+        virtual Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const = 0;
 
         Proxy_Function_Base(std::vector<Type_Info> t_types, int t_arity)
           : m_types(std::move(t_types)), m_arity(t_arity), m_has_arithmetic_param(false)
@@ -291,7 +304,7 @@ namespace chaiscript
         }
 
 
-        static bool compare_types(const std::vector<Type_Info> &tis, const std::vector<Boxed_Value> &bvs, 
+        static bool compare_types(const std::vector<Type_Info> &tis, const Function_Params &bvs, 
                                   const Type_Conversions_State &t_conversions)
         {
           if (tis.size() - 1 != bvs.size())
@@ -310,6 +323,7 @@ namespace chaiscript
         std::vector<Type_Info> m_types;
         int m_arity;
         bool m_has_arithmetic_param;
+        bool m_is_pure = false;
     };
   }
 
@@ -336,6 +350,24 @@ namespace chaiscript
     };
   }
 
+  namespace dispatch
+  {
+    inline bool Proxy_Function_Base::try_call(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions, Boxed_Value &t_result) const
+    {
+      try {
+        t_result = (*this)(params, t_conversions);
+        return true;
+      } catch (const exception::bad_boxed_cast &) {
+        //parameter failed to cast
+      } catch (const exception::arity_error &) {
+        //invalid num params
+      } catch (const exception::guard_error &) {
+        //guard failed to allow the function to execute
+      }
+      return false;
+    }
+  }
+
   namespace dispatch
   {
     /**
@@ -369,7 +401,7 @@ namespace chaiscript
                 && this->m_param_types == prhs->m_param_types);
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return call_match_internal(vals, t_conversions).first;
         }
@@ -395,7 +427,7 @@ namespace chaiscript
 
 
       protected:
-        bool test_guard(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const
+        bool test_guard(const Function_Params &params, const Type_Conversions_State &t_conversions) const
         {
           if (m_guard)
           {
@@ -413,7 +445,7 @@ namespace chaiscript
 
         // first result: is a match
         // second result: needs conversions
-        std::pair<bool, bool> call_match_internal(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        std::pair<bool, bool> call_match_internal(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           const auto comparison_result = [&](){
             if (m_arity < 0) {
@@ -481,7 +513,7 @@ namespace chaiscript
 
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           const auto match_results = call_match_internal(params, t_conversions);
           if (match_results.first)
@@ -534,7 +566,7 @@ namespace chaiscript
         }
 
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return m_f->call_match(build_param_list(vals), t_conversions);
         }
@@ -545,7 +577,7 @@ namespace chaiscript
         }
 
 
-        std::vector<Boxed_Value> build_param_list(const std::vector<Boxed_Value> &params) const
+        std::vector<Boxed_Value> build_param_list(const Function_Params &params) const
         {
           auto parg = params.begin();
           auto barg = m_args.begin();
@@ -602,7 +634,7 @@ namespace chaiscript
           return retval;
         }
 
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return (*m_f)(build_param_list(params), t_conversions);
         }
@@ -620,13 +652,38 @@ namespace chaiscript
         {
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return static_cast<int>(vals.size()) == get_arity() 
             && (compare_types(m_types, vals, t_conversions) && compare_types_with_cast(vals, t_conversions));
         }
 
-        virtual bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const = 0;
+        virtual bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const = 0;
+
+      protected:
+        /// Converts the parameters once and invokes the function on the converted values.
+        /// Parameters whose types cannot match are rejected before any conversion is attempted.
+        template<typename Func, typename Callable>
+          bool try_call_prepared(const Callable &t_f, const Function_Params &params,
+              const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const
+          {
+            if (!compare_types(m_types, params, t_conversions)) {
+              return false;
+            }
+
+            try {
+              t_result = detail::call_func(detail::Function_Signature<Func>(), t_f,
+                  detail::prepare_params(detail::Function_Signature<Func>(), params, t_conversions));
+              return true;
+            } catch (const exception::bad_boxed_cast &) {
+              //parameter failed to cast
+            } catch (const exception::arity_error &) {
+              //invalid num params
+            } catch (const exception::guard_error &) {
+              //guard failed to allow the function to execute
+            }
+            return false;
+          }
     };
 
 
@@ -642,7 +699,7 @@ namespace chaiscript
         {
         }
 
-        bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return detail::compare_types_cast(static_cast<Func *>(nullptr), vals, t_conversions);
         }
@@ -652,9 +709,14 @@ namespace chaiscript
           return dynamic_cast<const Proxy_Function_Callable_Impl<Func, Callable> *>(&t_func) != nullptr;
         }
 
+        bool try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+        {
+          return try_call_prepared<Func>(m_f, params, t_conversions, t_result);
+        }
+
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return detail::call_func(detail::Function_Signature<Func>(), m_f, params, t_conversions);
         }
@@ -686,7 +748,7 @@ namespace chaiscript
           assert(!m_shared_ptr_holder || m_shared_ptr_holder.get() == &m_f.get());
         }
 
-        bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return detail::compare_types_cast(static_cast<Func *>(nullptr), vals, t_conversions);
         }
@@ -696,6 +758,11 @@ namespace chaiscript
           return dynamic_cast<const Assignable_Proxy_Function_Impl<Func> *>(&t_func) != nullptr;
         }
 
+        bool try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+        {
+          return try_call_prepared<Func>(m_f.get(), params, t_conversions, t_result);
+        }
+
         std::function<Func> internal_function() const
         {
           return m_f.get();
@@ -706,7 +773,7 @@ namespace chaiscript
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return detail::call_func(detail::Function_Signature<Func>(), m_f.get(), params, t_conversions);
         }
@@ -743,7 +810,7 @@ namespace chaiscript
           }
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &) const override
         {
           if (vals.size() != 1)
           {
@@ -754,7 +821,7 @@ namespace chaiscript
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           const Boxed_Value &bv = params[0];
           if (bv.is_const())
@@ -813,16 +880,16 @@ namespace chaiscript
     class dispatch_error : public std::runtime_error
     {
       public:
-        dispatch_error(std::vector<Boxed_Value> t_parameters, 
+        dispatch_error(const Function_Params &t_parameters, 
             std::vector<Const_Proxy_Function> t_functions)
-          : std::runtime_error("Error with function dispatch"), parameters(std::move(t_parameters)), functions(std::move(t_functions))
+          : std::runtime_error("Error with function dispatch"), parameters(t_parameters.to_vector()), functions(std::move(t_functions))
         {
         }
 
-        dispatch_error(std::vector<Boxed_Value> t_parameters, 
+        dispatch_error(const Function_Params &t_parameters, 
             std::vector<Const_Proxy_Function> t_functions,
             const std::string &t_desc)
-          : std::runtime_error(t_desc), parameters(std::move(t_parameters)), functions(std::move(t_functions))
+          : std::runtime_error(t_desc), parameters(t_parameters.to_vector()), functions(std::move(t_functions))
         {
         }
 
@@ -840,7 +907,7 @@ namespace chaiscript
     namespace detail 
     {
       template<typename FuncType>
-        bool types_match_except_for_arithmetic(const FuncType &t_func, const std::vector<Boxed_Value> &plist,
+        bool types_match_except_for_arithmetic(const FuncType &t_func, const Function_Params &plist,
             const Type_Conversions_State &t_conversions)
         {
           const std::vector<Type_Info> &types = t_func->get_param_types();
@@ -859,7 +926,7 @@ namespace chaiscript
         }
 
       template<typename InItr, typename Funcs>
-        Boxed_Value dispatch_with_conversions(InItr begin, const InItr &end, const std::vector<Boxed_Value> &plist, 
+        Boxed_Value dispatch_with_conversions(InItr begin, const InItr &end, const Function_Params &plist, 
             const Type_Conversions_State &t_conversions, const Funcs &t_funcs)
         {
           InItr matching_func(end);
@@ -934,7 +1001,7 @@ namespace chaiscript
     /// function is found or throw dispatch_error if no matching function is found
     template<typename Funcs>
       Boxed_Value dispatch(const Funcs &funcs,
-          const std::vector<Boxed_Value> &plist, const Type_Conversions_State &t_conversions)
+          const Function_Params &plist, const Type_Conversions_State &t_conversions)
       {
         std::vector<std::pair<size_t, const Proxy_Function_Base *>> ordered_funcs;
         ordered_funcs.reserve(funcs.size());
@@ -964,18 +1031,12 @@ namespace chaiscript
         {
           for (const auto &func : ordered_funcs )
           {
-            try {
-              if (func.first == i && (i == 0 || func.second->filter(plist, t_conversions)))
-              {
-                return (*(func.second))(plist, t_conversions);
+            if (func.first == i && (i == 0 || func.second->filter(plist, t_conversions)))
+            {
+              Boxed_Value result;
+              if (func.second->try_call(plist, t_conversions, result)) {
+                return result;
               }
-            } catch (const exception::bad_boxed_cast &) {
-              //parameter failed to cast, try again
-            } catch (const exception::arity_error &) {
-              //invalid num params, try again
-            } catch (const exception::guard_error &) {
-              //guard failed to allow the function to execute,
-              //try again
             }
           }
         }
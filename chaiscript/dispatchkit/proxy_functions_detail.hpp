@@ -13,6 +13,8 @@
 
 #include <functional>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <array>
 
@@ -22,6 +24,7 @@
 #include "handle_return.hpp"
 #include "type_info.hpp"
 #include "callable_traits.hpp"
+#include "function_params.hpp"
 
 namespace chaiscript {
 class Type_Conversions_State;
@@ -71,6 +74,28 @@ namespace chaiscript
         }
 
 
+      /// The arguments of a function call after conversion from Boxed_Value,
+      /// exactly as boxed_cast produces them for each parameter
+      template<typename ... Params>
+        using Prepared_Params = std::tuple<decltype(boxed_cast<Params>(std::declval<const Boxed_Value &>(), nullptr))...>;
+
+      /// Converts every parameter once, in order. Throws bad_boxed_cast if any conversion fails.
+      template<typename Ret, typename ... Params, size_t ... I>
+        Prepared_Params<Params...> prepare_params(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &,
+                      std::index_sequence<I...>, const Function_Params &params, const Type_Conversions_State &t_conversions)
+        {
+          (void)params; (void)t_conversions;
+          // this is ok because the order of evaluation of braced initializer lists is well defined
+          return Prepared_Params<Params...>{boxed_cast<Params>(params[I], &t_conversions)...};
+        }
+
+      template<typename Ret, typename ... Params>
+        Prepared_Params<Params...> prepare_params(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &sig,
+                      const Function_Params &params, const Type_Conversions_State &t_conversions)
+        {
+          return prepare_params(sig, std::index_sequence_for<Params...>{}, params, t_conversions);
+        }
+
       /**
        * Used by Proxy_Function_Impl to determine if it is equivalent to another
        * Proxy_Function_Impl object. This function is primarily used to prevent
@@ -78,14 +103,10 @@ namespace chaiscript
        */
       template<typename Ret, typename ... Params>
         bool compare_types_cast(Ret (*)(Params...),
-             const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+             const Function_Params &params, const Type_Conversions_State &t_conversions)
         {
           try {
-            std::vector<Boxed_Value>::size_type i = 0;
-            (void)i;
-            (void)params; (void)t_conversions;
-            // this is ok because the order of evaluation of initializer lists is well defined
-            (void)std::initializer_list<int>{(boxed_cast<Params>(params[i++], &t_conversions), 0)...};
+            (void)prepare_params(Function_Signature<Ret (Params...)>(), params, t_conversions);
             return true;
           } catch (const exception::bad_boxed_cast &) {
             return false;
@@ -95,30 +116,27 @@ namespace chaiscript
 
       template<typename Callable, typename Ret, typename ... Params, size_t ... I>
         Ret call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &, 
-                      std::index_sequence<I...>, const Callable &f,
-                      const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+                      std::index_sequence<I...>, const Callable &f, Prepared_Params<Params...> &&args)
         {
-          (void)params; (void)t_conversions;
-          return f(boxed_cast<Params>(params[I], &t_conversions)...);
+          (void)args;
+          return f(std::get<I>(std::move(args))...);
         }
 
 
-      /// Used by Proxy_Function_Impl to perform typesafe execution of a function.
-      /// The function attempts to unbox each parameter to the expected type.
-      /// if any unboxing fails the execution of the function fails and
-      /// the bad_boxed_cast is passed up to the caller.
+      /// Used by Proxy_Function_Impl to perform typesafe execution of a function
+      /// on parameters that have already been converted by prepare_params.
       template<typename Callable, typename Ret, typename ... Params>
         Boxed_Value call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &sig, const Callable &f,
-            const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+            Prepared_Params<Params...> &&args)
         {
-          return Handle_Return<Ret>::handle(call_func(sig, std::index_sequence_for<Params...>{}, f, params, t_conversions));
+          return Handle_Return<Ret>::handle(call_func(sig, std::index_sequence_for<Params...>{}, f, std::move(args)));
         }
 
       template<typename Callable, typename ... Params>
         Boxed_Value call_func(const chaiscript::dispatch::detail::Function_Signature<void (Params...)> &sig, const Callable &f,
-            const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+            Prepared_Params<Params...> &&args)
         {
-          call_func(sig, std::index_sequence_for<Params...>{}, f, params, t_conversions);
+          call_func(sig, std::index_sequence_for<Params...>{}, f, std::move(args));
 #ifdef CHAISCRIPT_MSVC
 #pragma warning(push)
 #pragma warning(disable : 4702)
@@ -130,6 +148,17 @@ namespace chaiscript
 #endif
         }
 
+      /// Used by Proxy_Function_Impl to perform typesafe execution of a function.
+      /// The function attempts to unbox each parameter to the expected type.
+      /// if any unboxing fails the execution of the function fails and
+      /// the bad_boxed_cast is passed up to the caller.
+      template<typename Callable, typename Ret, typename ... Params>
+        Boxed_Value call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &sig, const Callable &f,
+            const Function_Params &params, const Type_Conversions_State &t_conversions)
+        {
+          return call_func(sig, f, prepare_params(sig, params, t_conversions));
+        }
+
     }
   }
 
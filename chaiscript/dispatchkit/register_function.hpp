@@ -144,6 +144,30 @@ namespace chaiscript
       return fun(detail::bind_first(std::forward<T>(t), q));
     }
 
+  /// \brief Creates a new Proxy_Function object like fun() and marks it as pure
+  /// \param[in] t Function to expose; its result must depend only on its arguments and
+  ///              calling it must have no side effects
+  ///
+  /// Calls to a pure function whose arguments are all constants are evaluated once and
+  /// the result is reused on later evaluations of the same call.
+  ///
+  /// \b Example:
+  /// \code
+  /// int square(int x) { return x * x; }
+  ///
+  /// chaiscript::ChaiScript chai;
+  /// chai.add(pure_fun(&square), "square");
+  /// \endcode
+  /// 
+  /// \sa \ref adding_functions
+  template<typename T>
+    Proxy_Function pure_fun(T &&t)
+    {
+      auto f = fun(std::forward<T>(t));
+      f->set_pure(true);
+      return f;
+    }
+
 
 }
 
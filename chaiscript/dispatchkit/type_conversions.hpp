@@ -326,17 +326,10 @@ namespace chaiscript
         std::vector<Boxed_Value> saves;
       };
 
-      struct Less_Than
-      {
-        bool operator()(const std::type_info *t_lhs, const std::type_info *t_rhs) const
-        {
-          return *t_lhs != *t_rhs && t_lhs->before(*t_rhs);
-        }
-      };
-
       Type_Conversions()
         : m_mutex(),
           m_conversions(),
+          m_by_to(),
           m_convertableTypes(),
           m_num_types(0)
       {
@@ -348,16 +341,18 @@ namespace chaiscript
       Type_Conversions &operator=(const Type_Conversions &) = delete;
       Type_Conversions &operator=(Type_Conversions &&) = default;
 
-      const std::set<const std::type_info *, Less_Than> &thread_cache() const
+      /// Flat table, indexed by bare type id, of the types that take part in any conversion
+      const std::vector<bool> &thread_cache() const
       {
         auto &cache = *m_thread_cache;
-        if (cache.size() != m_num_types)
+        if (cache.first != m_num_types)
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-          cache = m_convertableTypes;
+          cache.first = m_num_types;
+          cache.second = m_convertableTypes;
         }
 
-        return cache;
+        return cache.second;
       }
 
       void add_conversion(const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
@@ -365,14 +360,26 @@ namespace chaiscript
         chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
         /// \todo error if a conversion already exists
         m_conversions.insert(conversion);
-        m_convertableTypes.insert({conversion->to().bare_type_info(), conversion->from().bare_type_info()});
-        m_num_types = m_convertableTypes.size();
+        const auto to = conversion->to().bare_type_id();
+        const auto from = conversion->from().bare_type_id();
+        for (const auto id : {to, from}) {
+          if (id >= m_convertableTypes.size()) {
+            m_convertableTypes.resize(id + 1, false);
+            m_by_to.resize(id + 1);
+          }
+          m_convertableTypes[id] = true;
+        }
+        m_by_to[to].push_back(Indexed_Conversion{from, false, conversion});
+        if (conversion->bidir()) {
+          m_by_to[from].push_back(Indexed_Conversion{to, true, conversion});
+        }
+        ++m_num_types;
       }
 
       template<typename T>
         bool convertable_type() const
         {
-          return thread_cache().count(user_type<T>().bare_type_info()) != 0;
+          return is_convertable(thread_cache(), user_type<T>());
         }
 
       template<typename To, typename From>
@@ -384,7 +391,7 @@ namespace chaiscript
       bool converts(const Type_Info &to, const Type_Info &from) const
       {
         const auto &types = thread_cache();
-        if (types.count(to.bare_type_info()) != 0 && types.count(from.bare_type_info()) != 0)
+        if (is_convertable(types, to) && is_convertable(types, from))
         {
           return has_conversion(to, from);
         } else {
@@ -446,18 +453,18 @@ namespace chaiscript
       bool has_conversion(const Type_Info &to, const Type_Info &from) const
       {
         chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-        return find_bidir(to, from) != m_conversions.end();
+        return find(to, from, true) != nullptr;
       }
 
       std::shared_ptr<detail::Type_Conversion_Base> get_conversion(const Type_Info &to, const Type_Info &from) const
       {
         chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-        const auto itr = find(to, from);
+        auto conversion = find(to, from, false);
 
-        if (itr != m_conversions.end())
+        if (conversion)
         {
-          return *itr;
+          return conversion;
         } else {
           throw std::out_of_range("No such conversion exists from " + from.bare_name() + " to " + to.bare_name());
         }
@@ -468,27 +475,24 @@ namespace chaiscript
       }
 
     private:
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find_bidir(
-          const Type_Info &to, const Type_Info &from) const
+      static bool is_convertable(const std::vector<bool> &t_types, const Type_Info &t_ti)
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion) -> bool
-              {
-                return  (conversion->to().bare_equal(to) && conversion->from().bare_equal(from))
-                     || (conversion->bidir() && conversion->from().bare_equal(to) && conversion->to().bare_equal(from));
-              }
-        );
+        return t_ti.bare_type_id() < t_types.size() && t_types[t_ti.bare_type_id()];
       }
 
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find(
-          const Type_Info &to, const Type_Info &from) const
+      /// The conversion from from to to, or nullptr. t_bidir also finds a bidirectional
+      /// conversion registered the other way round. The caller holds m_mutex.
+      std::shared_ptr<detail::Type_Conversion_Base> find(const Type_Info &to, const Type_Info &from, const bool t_bidir) const
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
-              {
-                return conversion->to().bare_equal(to) && conversion->from().bare_equal(from);
-              }
-        );
+        if (to.bare_type_id() >= m_by_to.size()) {
+          return nullptr;
+        }
+        for (const auto &c : m_by_to[to.bare_type_id()]) {
+          if (c.from == from.bare_type_id() && (t_bidir || !c.reversed)) {
+            return c.conversion;
+          }
+        }
+        return nullptr;
       }
 
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> get_conversions() const
@@ -500,11 +504,22 @@ namespace chaiscript
 
 
 
+      /// A conversion as listed under the type it converts to
+      struct Indexed_Conversion
+      {
+        unsigned int from;
+        bool reversed;
+        std::shared_ptr<detail::Type_Conversion_Base> conversion;
+      };
+
       mutable chaiscript::detail::threading::shared_mutex m_mutex;
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> m_conversions;
-      std::set<const std::type_info *, Less_Than> m_convertableTypes;
+      /// Flat table, indexed by bare type id, of the conversions to each type. A
+      /// bidirectional conversion is also listed, reversed, under the type it converts from
+      std::vector<std::vector<Indexed_Conversion>> m_by_to;
+      std::vector<bool> m_convertableTypes;
       std::atomic_size_t m_num_types;
-      mutable chaiscript::detail::threading::Thread_Storage<std::set<const std::type_info *, Less_Than>> m_thread_cache;
+      mutable chaiscript::detail::threading::Thread_Storage<std::pair<size_t, std::vector<bool>>> m_thread_cache;
       mutable chaiscript::detail::threading::Thread_Storage<Conversion_Saves> m_conversion_saves;
   };
 
@@ -13,8 +13,12 @@
 
 #include <memory>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
 #include <string>
+#include <unordered_map>
+
+#include "../chaiscript_threading.hpp"
 
 namespace chaiscript
 {
@@ -26,6 +30,35 @@ namespace chaiscript
       {
         typedef typename std::remove_cv<typename std::remove_pointer<typename std::remove_reference<T>::type>::type>::type type;
       };
+
+    /// Assigns each distinct std::type_info a small dense integer, in order of first use.
+    /// 0 is reserved for the undefined type.
+    inline unsigned int register_type_id(const std::type_info &t_ti)
+    {
+      static chaiscript::detail::threading::mutex s_mutex;
+      static std::unordered_map<std::type_index, unsigned int> s_ids;
+
+      chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::mutex> l(s_mutex);
+      return s_ids.emplace(t_ti, static_cast<unsigned int>(s_ids.size() + 1)).first->second;
+    }
+
+    /// Caches the id of typeid(T) so the registry is only consulted once per type
+    template<typename T>
+      struct Type_Id
+      {
+        static unsigned int get()
+        {
+          static const unsigned int id = register_type_id(typeid(T));
+          return id;
+        }
+      };
+
+    /// Returns the id matching typeid(T), which ignores references and top level cv qualifiers
+    template<typename T>
+      unsigned int type_id()
+      {
+        return Type_Id<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::get();
+      }
   }
 
 
@@ -33,9 +66,11 @@ namespace chaiscript
   class Type_Info
   {
     public:
-      constexpr Type_Info(const bool t_is_const, const bool t_is_reference, const bool t_is_pointer, const bool t_is_void, 
-          const bool t_is_arithmetic, const std::type_info *t_ti, const std::type_info *t_bare_ti)
+      Type_Info(const bool t_is_const, const bool t_is_reference, const bool t_is_pointer, const bool t_is_void, 
+          const bool t_is_arithmetic, const std::type_info *t_ti, const std::type_info *t_bare_ti,
+          const unsigned int t_type_id, const unsigned int t_bare_type_id)
         : m_type_info(t_ti), m_bare_type_info(t_bare_ti),
+          m_type_id(t_type_id), m_bare_type_id(t_bare_type_id),
           m_flags((static_cast<unsigned int>(t_is_const) << is_const_flag)
                 + (static_cast<unsigned int>(t_is_reference) << is_reference_flag)
                 + (static_cast<unsigned int>(t_is_pointer) << is_pointer_flag)
@@ -46,9 +81,12 @@ namespace chaiscript
 
       constexpr Type_Info() = default;
 
+      /// Ordered as std::type_info::before orders the types, not by id: ids follow first
+      /// use, and overload resolution breaks ties with this order, so it must not depend
+      /// on which types happened to be registered first
       bool operator<(const Type_Info &ti) const noexcept
       {
-        return m_type_info->before(*ti.m_type_info);
+        return m_type_id != ti.m_type_id && m_type_info->before(*ti.m_type_info);
       }
 
       constexpr bool operator!=(const Type_Info &ti) const noexcept
@@ -63,8 +101,7 @@ namespace chaiscript
 
       constexpr bool operator==(const Type_Info &ti) const noexcept
       {
-        return ti.m_type_info == m_type_info
-           || *ti.m_type_info == *m_type_info;
+        return ti.m_type_id == m_type_id;
       }
 
       constexpr bool operator==(const std::type_info &ti) const noexcept
@@ -74,8 +111,7 @@ namespace chaiscript
 
       constexpr bool bare_equal(const Type_Info &ti) const noexcept
       {
-        return ti.m_bare_type_info == m_bare_type_info
-           || *ti.m_bare_type_info == *m_bare_type_info;
+        return ti.m_bare_type_id == m_bare_type_id;
       }
 
       constexpr bool bare_equal_type_info(const std::type_info &ti) const noexcept
@@ -83,6 +119,12 @@ namespace chaiscript
         return !is_undef() && (*m_bare_type_info) == ti;
       }
 
+      /// Dense id of the full type, suitable for indexing flat lookup tables
+      constexpr unsigned int type_id() const noexcept { return m_type_id; }
+
+      /// Dense id of the type with references, pointers and cv qualifiers removed
+      constexpr unsigned int bare_type_id() const noexcept { return m_bare_type_id; }
+
       constexpr bool is_const() const noexcept { return (m_flags & (1 << is_const_flag)) != 0; }
       constexpr bool is_reference() const noexcept { return (m_flags & (1 << is_reference_flag)) != 0; }
       constexpr bool is_void() const noexcept { return (m_flags & (1 << is_void_flag)) != 0; }
@@ -120,6 +162,8 @@ namespace chaiscript
 
       const std::type_info *m_type_info = &typeid(Unknown_Type);
       const std::type_info *m_bare_type_info = &typeid(Unknown_Type);
+      unsigned int m_type_id = 0;
+      unsigned int m_bare_type_id = 0;
       static const int is_const_flag = 0;
       static const int is_reference_flag = 1;
       static const int is_pointer_flag = 2;
@@ -135,7 +179,7 @@ namespace chaiscript
     template<typename T>
       struct Get_Type_Info
       {
-        static constexpr Type_Info get()
+        static Type_Info get()
         {
           return Type_Info(std::is_const<typename std::remove_pointer<typename std::remove_reference<T>::type>::type>::value, 
               std::is_reference<T>::value, std::is_pointer<T>::value, 
@@ -143,7 +187,9 @@ namespace chaiscript
               (std::is_arithmetic<T>::value || std::is_arithmetic<typename std::remove_reference<T>::type>::value)
                 && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
               &typeid(T),
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(typename Bare_Type<T>::type),
+              type_id<T>(),
+              type_id<typename Bare_Type<T>::type>());
         }
       };
 
@@ -152,13 +198,15 @@ namespace chaiscript
       {
 //        typedef T type;
 
-        static constexpr Type_Info get()
+        static Type_Info get()
         {
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(std::shared_ptr<T> ), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(std::shared_ptr<T>),
+              &typeid(typename Bare_Type<T>::type),
+              type_id<std::shared_ptr<T>>(),
+              type_id<typename Bare_Type<T>::type>());
         }
       };
 
@@ -170,39 +218,45 @@ namespace chaiscript
     template<typename T>
       struct Get_Type_Info<const std::shared_ptr<T> &>
       {
-        static constexpr Type_Info get()
+        static Type_Info get()
         {
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(const std::shared_ptr<T> &), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(const std::shared_ptr<T> &),
+              &typeid(typename Bare_Type<T>::type),
+              type_id<const std::shared_ptr<T> &>(),
+              type_id<typename Bare_Type<T>::type>());
         }
       };
 
     template<typename T>
       struct Get_Type_Info<std::reference_wrapper<T> >
       {
-        static constexpr Type_Info get()
+        static Type_Info get()
         {
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(std::reference_wrapper<T> ), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(std::reference_wrapper<T>),
+              &typeid(typename Bare_Type<T>::type),
+              type_id<std::reference_wrapper<T>>(),
+              type_id<typename Bare_Type<T>::type>());
         }
       };
 
     template<typename T>
       struct Get_Type_Info<const std::reference_wrapper<T> &>
       {
-        static constexpr Type_Info get()
+        static Type_Info get()
         {
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(const std::reference_wrapper<T> &), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(const std::reference_wrapper<T> &),
+              &typeid(typename Bare_Type<T>::type),
+              type_id<const std::reference_wrapper<T> &>(),
+              type_id<typename Bare_Type<T>::type>());
         }
       };
 
@@ -218,7 +272,7 @@ namespace chaiscript
   /// chaiscript::Type_Info ti = chaiscript::user_type(i);
   /// \endcode
   template<typename T>
-  constexpr Type_Info user_type(const T &/*t*/)
+  Type_Info user_type(const T &/*t*/)
   {
     return detail::Get_Type_Info<T>::get();
   }
@@ -233,7 +287,7 @@ namespace chaiscript
   /// chaiscript::Type_Info ti = chaiscript::user_type<int>();
   /// \endcode
   template<typename T>
-  constexpr Type_Info user_type()
+  Type_Info user_type()
   {
     return detail::Get_Type_Info<T>::get();
   }
@@ -22,6 +22,7 @@
 #include <stdexcept>
 #include <vector>
 #include <cstring>
+#include <typeindex>
 
 #include "../chaiscript_defines.hpp"
 #include "../chaiscript_threading.hpp"
@@ -79,13 +80,18 @@ namespace chaiscript
 
     std::unique_ptr<parser::ChaiScript_Parser_Base> m_parser;
 
+    std::unique_ptr<chaiscript::detail::Memory_Quota, chaiscript::detail::Memory_Quota::Detach> m_memory_quota;
+
     chaiscript::detail::Dispatch_Engine m_engine;
 
     std::map<std::string, std::function<Namespace&()>> m_namespace_generators;
 
+    friend class Module;
+
     /// Evaluates the given string in by parsing it and running the results through the evaluator
     Boxed_Value do_eval(const std::string &t_input, const std::string &t_filename = "__EVAL__", bool /* t_internal*/  = false) 
     {
+      const auto scope = memory_scope();
       try {
         const auto p = m_parser->parse(t_input, t_filename);
         return p->eval(chaiscript::detail::Dispatch_State(m_engine));
@@ -97,6 +103,40 @@ namespace chaiscript
 
 
 
+    /// Evaluates a script bundled with a Module (such as the standard prelude).
+    /// Module scripts are identical for every engine built with the same parser,
+    /// so the optimized AST is parsed once per process and shared between engines.
+    Boxed_Value eval_module_script(const std::string &t_input)
+    {
+      static chaiscript::detail::threading::mutex s_mutex;
+      static std::map<std::pair<std::type_index, std::string>, std::shared_ptr<const AST_Node>> s_parsed;
+
+      const auto key = std::make_pair(std::type_index(typeid(*m_parser)), t_input);
+
+      std::shared_ptr<const AST_Node> p;
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::mutex> l(s_mutex);
+        const auto itr = s_parsed.find(key);
+        if (itr != s_parsed.end()) {
+          p = itr->second;
+        }
+      }
+
+      if (!p) {
+        p = m_parser->parse(t_input, "__EVAL__");
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::mutex> l(s_mutex);
+        s_parsed.emplace(key, p);
+      }
+
+      const auto scope = memory_scope();
+      try {
+        return p->eval(chaiscript::detail::Dispatch_State(m_engine));
+      }
+      catch (chaiscript::eval::detail::Return_Value &rv) {
+        return rv.retval;
+      }
+    }
+
     /// Evaluates the given file and looks in the 'use' paths
     const Boxed_Value internal_eval_file(const std::string &t_filename) {
       for (const auto &path : m_use_paths)
@@ -149,7 +189,7 @@ namespace chaiscript
 
       m_engine.add(
           dispatch::make_dynamic_proxy_function(
-              [this](const std::vector<Boxed_Value> &t_params) {
+              [this](const Function_Params &t_params) {
                 return m_engine.call_exists(t_params);
               })
           , "call_exists");
@@ -356,6 +396,7 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
 
     const Boxed_Value eval(const AST_Node &t_ast)
     {
+      const auto scope = memory_scope();
       try {
         return t_ast.eval(chaiscript::detail::Dispatch_State(m_engine));
       } catch (const exception::eval_error &t_ee) {
@@ -363,6 +404,39 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
       }
     }
 
+    /// \brief Caps the memory that scripts evaluated by this engine may allocate
+    ///
+    /// Boxed values and the internal objects behind them are charged while the engine
+    /// evaluates a script, or while a scope returned by memory_scope() is alive. An
+    /// allocation that would pass the limit throws exception::memory_limit_error, which
+    /// scripts can catch like any other exception.
+    ///
+    /// \param[in] t_bytes Limit in bytes
+    void set_memory_limit(const std::size_t t_bytes)
+    {
+      if (m_memory_quota) {
+        m_memory_quota->set_limit(t_bytes);
+      } else {
+        m_memory_quota = chaiscript::detail::Memory_Quota::create(t_bytes);
+      }
+    }
+
+    /// \returns the number of bytes currently charged to this engine's memory limit,
+    ///          0 if no limit was set
+    std::size_t get_memory_used() const
+    {
+      return m_memory_quota ? m_memory_quota->used() : 0;
+    }
+
+    /// \brief Charges allocations made on this thread to this engine while the returned object lives
+    ///
+    /// eval() does this itself. Hosts need it when they call script functions directly,
+    /// for example through a std::function obtained from boxed_cast.
+    chaiscript::detail::Memory_Quota::Scope memory_scope() const
+    {
+      return chaiscript::detail::Memory_Quota::Scope(m_memory_quota.get());
+    }
+
     AST_NodePtr parse(const std::string &t_input, const bool t_debug_print = false)
     {
       auto ast = m_parser->parse(t_input, "PARSE");
@@ -695,6 +769,13 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
       {
         return(m_engine.boxed_cast<Type>(bv));
       }
+
+    /// \brief Calls a function with the given parameters while applying any Dynamic_Conversion available
+    Boxed_Value call_function(const dispatch::Proxy_Function_Base &t_func, const Function_Params &t_params)
+    {
+      Type_Conversions_State s(m_engine.conversions(), m_engine.conversions().conversion_saves());
+      return t_func(t_params, s);
+    }
  
 
     /// \brief Evaluates a string.
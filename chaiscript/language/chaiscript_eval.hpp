@@ -11,6 +11,8 @@
 #ifndef CHAISCRIPT_EVAL_HPP_
 #define CHAISCRIPT_EVAL_HPP_
 
+#include <algorithm>
+#include <array>
 #include <exception>
 #include <functional>
 #include <limits>
@@ -19,6 +21,7 @@
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../chaiscript_defines.hpp"
@@ -53,7 +56,7 @@ namespace chaiscript
     {
       /// Helper function that will set up the scope around a function call, including handling the named function parameters
       template<typename T>
-      static Boxed_Value eval_function(chaiscript::detail::Dispatch_Engine &t_ss, const AST_Node_Impl<T> &t_node, const std::vector<std::string> &t_param_names, const std::vector<Boxed_Value> &t_vals, const std::map<std::string, Boxed_Value> *t_locals=nullptr, bool has_this_capture = false) {
+      static Boxed_Value eval_function(chaiscript::detail::Dispatch_Engine &t_ss, const AST_Node_Impl<T> &t_node, const std::vector<std::string> &t_param_names, const Function_Params &t_vals, const std::map<std::string, Boxed_Value> *t_locals=nullptr, bool has_this_capture = false) {
         chaiscript::detail::Dispatch_State state(t_ss);
 
         const Boxed_Value *thisobj = [&]() -> const Boxed_Value *{
@@ -98,7 +101,7 @@ namespace chaiscript
           } else if (incoming.get_type_info().bare_equal_type_info(typeid(bool))) {
             return Boxed_Value(*static_cast<const bool*>(incoming.get_const_ptr()));
           } else {
-            return t_ss->call_function("clone", t_loc, {incoming}, t_ss.conversions());
+            return t_ss->call_function("clone", t_loc, Function_Params{incoming}, t_ss.conversions());
           }
         } else {
           incoming.reset_return_value();
@@ -201,8 +204,9 @@ namespace chaiscript
               }
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({t_lhs, m_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, m_rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{t_lhs, m_rhs}};
+              fpp.save_params(params);
+              return t_ss->call_function(t_oper_string, m_loc, params, t_ss.conversions());
             }
           }
           catch(const exception::dispatch_error &e){
@@ -247,8 +251,9 @@ namespace chaiscript
               }
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({t_lhs, t_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, t_rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{t_lhs, t_rhs}};
+              fpp.save_params(params);
+              return t_ss->call_function(t_oper_string, m_loc, params, t_ss.conversions());
             }
           }
           catch(const exception::dispatch_error &e){
@@ -309,8 +314,9 @@ namespace chaiscript
             assert(!this->children.empty());
           }
 
+        /// t_fn, when given, is the already evaluated callee
         template<bool Save_Params>
-        Boxed_Value do_eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const
+        Boxed_Value do_eval_internal(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value *t_fn = nullptr) const
         {
           chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
 
@@ -325,7 +331,7 @@ namespace chaiscript
             fpp.save_params(params);
           }
 
-          Boxed_Value fn(this->children[0]->eval(t_ss));
+          Boxed_Value fn(t_fn ? *t_fn : this->children[0]->eval(t_ss));
 
           using ConstFunctionTypePtr = const dispatch::Proxy_Function_Base *;
           try {
@@ -374,6 +380,106 @@ namespace chaiscript
         }
     };
 
+    /// Call whose arguments are all constants. When the name resolves to a pure function,
+    /// the first result is kept and later evaluations that resolve to that same function
+    /// object return a copy of it without calling. Results are kept per function object,
+    /// a few at a time, so engines sharing this node (module scripts are parsed once per
+    /// process) or a name that is redefined each get their own. The last function found
+    /// impure, or whose result can't be kept, is remembered and called like any other,
+    /// without taking the lock.
+    template<typename T>
+    struct Constant_Arg_Fun_Call_AST_Node final : Fun_Call_AST_Node<T> {
+        Constant_Arg_Fun_Call_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
+          Fun_Call_AST_Node<T>(std::move(t_ast_node_text), std::move(t_loc), std::move(t_children)) { }
+
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override
+        {
+          const Boxed_Value fn(this->children[0]->eval(t_ss));
+          // identifies the function object without a cast
+          const void *id = fn.get_const_ptr();
+
+          if (m_unfoldable.load(std::memory_order_relaxed) == id) {
+            return this->template do_eval_internal<true>(t_ss, &fn);
+          }
+
+          {
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            for (const auto &fold : m_folds) {
+              if (fold.id == id) {
+                return copy_value(fold.value);
+              }
+            }
+          }
+
+          const auto func = get_function(t_ss, fn);
+          if (!func || !func->is_pure()) {
+            m_unfoldable.store(id, std::memory_order_relaxed);
+            return this->template do_eval_internal<true>(t_ss, &fn);
+          }
+
+          auto result = this->template do_eval_internal<true>(t_ss, &fn);
+
+          if (is_foldable(result)) {
+            chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            if (std::none_of(m_folds.begin(), m_folds.end(), [id](const Fold &f) { return f.id == id; })) {
+              if (m_folds.size() == MAX_FOLDS) {
+                m_folds.erase(m_folds.begin());
+              }
+              // holding the function keeps id from being reused by another one
+              m_folds.push_back(Fold{id, func, copy_value(result)});
+            }
+          } else {
+            m_unfoldable.store(id, std::memory_order_relaxed);
+          }
+
+          return result;
+        }
+
+      private:
+        static Const_Proxy_Function get_function(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_fn)
+        {
+          try {
+            return t_ss->boxed_cast<Const_Proxy_Function>(t_fn);
+          } catch (const std::exception &) {
+            // not a function; the regular call path reports the error
+            return Const_Proxy_Function();
+          }
+        }
+
+        // Only plain values are folded, and each evaluation hands out its own copy,
+        // so that a caller modifying the result cannot change the folded value
+        static bool is_foldable(const Boxed_Value &t_bv)
+        {
+          const auto &ti = t_bv.get_type_info();
+          return ti.is_arithmetic() || ti.bare_equal(user_type<bool>()) || ti.bare_equal(user_type<std::string>());
+        }
+
+        static Boxed_Value copy_value(const Boxed_Value &t_bv)
+        {
+          const auto &ti = t_bv.get_type_info();
+          if (ti.is_arithmetic()) {
+            return Boxed_Number::clone(t_bv);
+          } else if (ti.bare_equal(user_type<bool>())) {
+            return Boxed_Value(*static_cast<const bool *>(t_bv.get_const_ptr()));
+          } else {
+            return Boxed_Value(*static_cast<const std::string *>(t_bv.get_const_ptr()));
+          }
+        }
+
+        struct Fold
+        {
+          const void *id;
+          Const_Proxy_Function function;
+          Boxed_Value value;
+        };
+
+        static constexpr std::size_t MAX_FOLDS = 4;
+
+        mutable chaiscript::detail::threading::shared_mutex m_mutex;
+        mutable std::vector<Fold> m_folds;
+        mutable std::atomic<const void *> m_unfoldable{nullptr};
+    };
+
 
 
 
@@ -486,7 +592,8 @@ namespace chaiscript
               }
 
               try {
-                return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+                const std::array<Boxed_Value, 2> params{{std::move(lhs), rhs}};
+                return t_ss->call_function(this->text, m_loc, params, t_ss.conversions());
               }
               catch(const exception::dispatch_error &e){
                 throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
@@ -506,7 +613,8 @@ namespace chaiscript
           }
           else {
             try {
-              return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{std::move(lhs), rhs}};
+              return t_ss->call_function(this->text, m_loc, params, t_ss.conversions());
             } catch(const exception::dispatch_error &e){
               throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
             }
@@ -590,7 +698,7 @@ namespace chaiscript
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
           chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
 
-          const std::vector<Boxed_Value> params{this->children[0]->eval(t_ss), this->children[1]->eval(t_ss)};
+          const std::array<Boxed_Value, 2> params{{this->children[0]->eval(t_ss), this->children[1]->eval(t_ss)}};
 
           try {
             fpp.save_params(params);
@@ -632,7 +740,7 @@ namespace chaiscript
           fpp.save_params(params);
 
           try {
-            retval = t_ss->call_member(m_fun_name, m_loc, std::move(params), has_function_params, t_ss.conversions());
+            retval = t_ss->call_member(m_fun_name, m_loc, params, has_function_params, t_ss.conversions());
           }
           catch(const exception::dispatch_error &e){
             if (e.functions.empty())
@@ -648,7 +756,8 @@ namespace chaiscript
 
           if (this->children[1]->identifier == AST_Node_Type::Array_Call) {
             try {
-              retval = t_ss->call_function("[]", m_array_loc, {retval, this->children[1]->children[1]->eval(t_ss)}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{retval, this->children[1]->children[1]->eval(t_ss)}};
+              retval = t_ss->call_function("[]", m_array_loc, params, t_ss.conversions());
             }
             catch(const exception::dispatch_error &e){
               throw exception::eval_error("Can not find appropriate array lookup operator '[]'.", e.parameters, e.functions, true, *t_ss);
@@ -697,7 +806,7 @@ namespace chaiscript
           return Boxed_Value(
               dispatch::make_dynamic_proxy_function(
                   [engine, lambda_node = this->m_lambda_node, param_names = this->m_param_names, captures, 
-                   this_capture = this->m_this_capture] (const std::vector<Boxed_Value> &t_params)
+                   this_capture = this->m_this_capture] (const Function_Params &t_params)
                   {
                     return detail::eval_function(engine, *lambda_node, param_names, t_params, &captures, this_capture);
                   },
@@ -813,7 +922,7 @@ namespace chaiscript
           std::shared_ptr<dispatch::Proxy_Function_Base> guard;
           if (m_guard_node) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, guardnode = m_guard_node, t_param_names](const std::vector<Boxed_Value> &t_params)
+                [engine, guardnode = m_guard_node, t_param_names](const Function_Params &t_params)
                 {
                   return detail::eval_function(engine, *guardnode, t_param_names, t_params);
                 },
@@ -824,7 +933,7 @@ namespace chaiscript
             const std::string & l_function_name = this->children[0]->text;
             t_ss->add(
                 dispatch::make_dynamic_proxy_function(
-                  [engine, func_node = m_body_node, t_param_names](const std::vector<Boxed_Value> &t_params)
+                  [engine, func_node = m_body_node, t_param_names](const Function_Params &t_params)
                   {
                     return detail::eval_function(engine, *func_node, t_param_names, t_params);
                   },
@@ -915,7 +1024,7 @@ namespace chaiscript
           };
 
           const auto call_function = [&t_ss](const auto &t_funcs, const Boxed_Value &t_param) {
-            return dispatch::dispatch(*t_funcs, {t_param}, t_ss.conversions());
+            return dispatch::dispatch(*t_funcs, Function_Params{t_param}, t_ss.conversions());
           };
 
 
@@ -1022,21 +1131,30 @@ namespace chaiscript
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Switch, std::move(t_loc), std::move(t_children)) { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
-          bool breaking = false;
-          size_t currentCase = 1;
-          bool hasMatched = false;
-
           chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
 
           Boxed_Value match_value(this->children[0]->eval(t_ss));
 
-          while (!breaking && (currentCase < this->children.size())) {
+          return eval_cases(t_ss, this->children, 1, false, match_value, m_loc);
+        }
+
+        /// Runs the case and default blocks starting at t_first_case. With t_matched set,
+        /// every block from there on runs (fall-through); otherwise each case is compared
+        /// against t_match_value with a dispatched "==" until one matches.
+        static Boxed_Value eval_cases(const chaiscript::detail::Dispatch_State &t_ss, const std::vector<AST_Node_Impl_Ptr<T>> &t_children,
+            size_t t_first_case, bool t_matched, const Boxed_Value &t_match_value, std::atomic_uint_fast32_t &t_loc)
+        {
+          bool breaking = false;
+          size_t currentCase = t_first_case;
+          bool hasMatched = t_matched;
+
+          while (!breaking && (currentCase < t_children.size())) {
             try {
-              if (this->children[currentCase]->identifier == AST_Node_Type::Case) {
+              if (t_children[currentCase]->identifier == AST_Node_Type::Case) {
                 //This is a little odd, but because want to see both the switch and the case simultaneously, I do a downcast here.
                 try {
-                  if (hasMatched || boxed_cast<bool>(t_ss->call_function("==", m_loc, {match_value, this->children[currentCase]->children[0]->eval(t_ss)}, t_ss.conversions()))) {
-                    this->children[currentCase]->eval(t_ss);
+                  if (hasMatched || boxed_cast<bool>(t_ss->call_function("==", t_loc, std::array<Boxed_Value, 2>{{t_match_value, t_children[currentCase]->children[0]->eval(t_ss)}}, t_ss.conversions()))) {
+                    t_children[currentCase]->eval(t_ss);
                     hasMatched = true;
                   }
                 }
@@ -1044,8 +1162,8 @@ namespace chaiscript
                   throw exception::eval_error("Internal error: case guard evaluation not boolean");
                 }
               }
-              else if (this->children[currentCase]->identifier == AST_Node_Type::Default) {
-                this->children[currentCase]->eval(t_ss);
+              else if (t_children[currentCase]->identifier == AST_Node_Type::Default) {
+                t_children[currentCase]->eval(t_ss);
                 hasMatched = true;
               }
             }
@@ -1060,6 +1178,41 @@ namespace chaiscript
         mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
+    /// Switch whose case labels are all constants of type Key. The labels are looked up
+    /// in a hash table built by the optimizer instead of being compared one at a time.
+    /// Match values of any other type fall back to the dispatched comparisons.
+    template<typename T, typename Key>
+    struct Constant_Switch_AST_Node final : AST_Node_Impl<T> {
+        Constant_Switch_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children,
+            std::unordered_map<Key, size_t> t_cases, const size_t t_default_case) :
+          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Switch, std::move(t_loc), std::move(t_children)),
+          m_cases(std::move(t_cases)),
+          m_default_case(t_default_case),
+          m_key_type(user_type<Key>())
+        { }
+
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
+          chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+
+          Boxed_Value match_value(this->children[0]->eval(t_ss));
+
+          if (!match_value.get_type_info().bare_equal(m_key_type)) {
+            return Switch_AST_Node<T>::eval_cases(t_ss, this->children, 1, false, match_value, m_loc);
+          }
+
+          const auto itr = m_cases.find(*static_cast<const Key *>(match_value.get_const_ptr()));
+          // a default block that precedes the matching case is reached first and falls through into it
+          const auto first_case = (itr == m_cases.end()) ? m_default_case : std::min(itr->second, m_default_case);
+
+          return Switch_AST_Node<T>::eval_cases(t_ss, this->children, first_case, true, match_value, m_loc);
+        }
+
+        const std::unordered_map<Key, size_t> m_cases;
+        const size_t m_default_case;
+        const Type_Info m_key_type;
+        mutable std::atomic_uint_fast32_t m_loc = {0};
+    };
+
     template<typename T>
     struct Case_AST_Node final : AST_Node_Impl<T> {
         Case_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
@@ -1216,8 +1369,8 @@ namespace chaiscript
               return Boxed_Number::do_oper(m_oper, bv);
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({bv});
-              return t_ss->call_function(this->text, m_loc, {std::move(bv)}, t_ss.conversions());
+              fpp.save_params(Function_Params{bv});
+              return t_ss->call_function(this->text, m_loc, Function_Params{bv}, t_ss.conversions());
             }
           } catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Error with prefix operator evaluation: '" + this->text + "'", e.parameters, e.functions, false, *t_ss);
@@ -1284,7 +1437,8 @@ namespace chaiscript
           try {
             auto oper1 = this->children[0]->children[0]->children[0]->eval(t_ss);
             auto oper2 = this->children[0]->children[0]->children[1]->eval(t_ss);
-            return t_ss->call_function("generate_range", m_loc, {oper1, oper2}, t_ss.conversions());
+            const std::array<Boxed_Value, 2> params{{std::move(oper1), std::move(oper2)}};
+            return t_ss->call_function("generate_range", m_loc, params, t_ss.conversions());
           }
           catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Unable to generate range vector, while calling 'generate_range'", e.parameters, e.functions, false, *t_ss);
@@ -1452,7 +1606,7 @@ namespace chaiscript
           std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine(*t_ss);
           if (m_guard_node) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, t_param_names, guardnode = m_guard_node](const std::vector<Boxed_Value> &t_params) {
+                [engine, t_param_names, guardnode = m_guard_node](const Function_Params &t_params) {
                   return chaiscript::eval::detail::eval_function(engine, *guardnode, t_param_names, t_params);
                 }, 
                 static_cast<int>(numparams), m_guard_node);
@@ -1467,7 +1621,7 @@ namespace chaiscript
               t_ss->add(
                   std::make_shared<dispatch::detail::Dynamic_Object_Constructor>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                        [engine, t_param_names, node = m_body_node](const std::vector<Boxed_Value> &t_params) {
+                        [engine, t_param_names, node = m_body_node](const Function_Params &t_params) {
                           return chaiscript::eval::detail::eval_function(engine, *node, t_param_names, t_params);
                         },
                         static_cast<int>(numparams), m_body_node, param_types, guard
@@ -1484,7 +1638,7 @@ namespace chaiscript
               t_ss->add(
                   std::make_shared<dispatch::detail::Dynamic_Object_Function>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                      [engine, t_param_names, node = m_body_node](const std::vector<Boxed_Value> &t_params) {
+                      [engine, t_param_names, node = m_body_node](const Function_Params &t_params) {
                         return chaiscript::eval::detail::eval_function(engine, *node, t_param_names, t_params);
                       },
                       static_cast<int>(numparams), m_body_node, param_types, guard), type), 
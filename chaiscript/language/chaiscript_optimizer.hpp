@@ -176,6 +176,13 @@ namespace chaiscript {
     };
 
     struct Unused_Return {
+      /// Calls are optimized before the block around them, so Constant_Arg_Call has already
+      /// seen them; turning its calls into plain unused-return calls would undo the folding
+      template<typename T>
+        static bool is_constant_arg_call(const eval::AST_Node_Impl<T> &node) {
+          return dynamic_cast<const eval::Constant_Arg_Fun_Call_AST_Node<T> *>(&node) != nullptr;
+        }
+
       template<typename T>
         auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
           if ((node->identifier == AST_Node_Type::Block
@@ -184,7 +191,7 @@ namespace chaiscript {
           {
             for (size_t i = 0; i < node->children.size()-1; ++i) {
               auto child = node->children[i].get();
-              if (child->identifier == AST_Node_Type::Fun_Call) {
+              if (child->identifier == AST_Node_Type::Fun_Call && !is_constant_arg_call(*child)) {
                 node->children[i] = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(child->text, child->location, 
                     std::move(child->children));
               }
@@ -199,7 +206,7 @@ namespace chaiscript {
               auto num_sub_children = child_count(child);
               for (size_t i = 0; i < num_sub_children; ++i) {
                 auto &sub_child = child_at(child, i);
-                if (sub_child.identifier == AST_Node_Type::Fun_Call) {
+                if (sub_child.identifier == AST_Node_Type::Fun_Call && !is_constant_arg_call(sub_child)) {
                   child.children[i] = chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(sub_child.text, sub_child.location, std::move(sub_child.children));
                 }
               }
@@ -380,6 +387,24 @@ namespace chaiscript {
       }
     };
 
+    struct Constant_Arg_Call {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::Fun_Call
+            && node->children.size() == 2
+            && node->children[0]->identifier == AST_Node_Type::Id
+            && node->children[1]->identifier == AST_Node_Type::Arg_List
+            && std::all_of(node->children[1]->children.begin(), node->children[1]->children.end(),
+                           [](const auto &arg) { return arg->identifier == AST_Node_Type::Constant; }))
+        {
+          return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Constant_Arg_Fun_Call_AST_Node<T>>(node->text, node->location,
+              std::move(node->children));
+        }
+
+        return node;
+      }
+    };
+
     struct For_Loop {
       template<typename T>
       auto optimize(eval::AST_Node_Impl_Ptr<T> for_node) {
@@ -461,8 +486,65 @@ namespace chaiscript {
       }
     };
 
-    typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, 
-      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop, optimizer::Assign_Decl> Optimizer_Default; 
+    struct Switch {
+      template<typename T>
+      auto optimize(eval::AST_Node_Impl_Ptr<T> node) {
+        if (node->identifier == AST_Node_Type::Switch && node->children.size() > 1) {
+          const auto &first_label = first_case_label(*node);
+          if (first_label.get_type_info().bare_equal(user_type<int>())) {
+            return make_constant_switch<int>(std::move(node));
+          } else if (first_label.get_type_info().bare_equal(user_type<std::string>())) {
+            return make_constant_switch<std::string>(std::move(node));
+          }
+        }
+
+        return node;
+      }
+
+      private:
+        template<typename T>
+        static const Boxed_Value &first_case_label(const eval::AST_Node_Impl<T> &node) {
+          static const Boxed_Value empty;
+          for (size_t i = 1; i < node.children.size(); ++i) {
+            const auto &child = *node.children[i];
+            if (child.identifier == AST_Node_Type::Case && child.children[0]->identifier == AST_Node_Type::Constant) {
+              return dynamic_cast<const eval::Constant_AST_Node<T> &>(*child.children[0]).m_value;
+            }
+          }
+          return empty;
+        }
+
+        template<typename Key, typename T>
+        static eval::AST_Node_Impl_Ptr<T> make_constant_switch(eval::AST_Node_Impl_Ptr<T> node) {
+          std::unordered_map<Key, size_t> cases;
+          size_t default_case = node->children.size();
+
+          for (size_t i = 1; i < node->children.size(); ++i) {
+            const auto &child = *node->children[i];
+            if (child.identifier == AST_Node_Type::Default) {
+              default_case = std::min(default_case, i);
+            } else if (child.identifier == AST_Node_Type::Case) {
+              if (child.children[0]->identifier != AST_Node_Type::Constant) {
+                return node;
+              }
+
+              const auto &label = dynamic_cast<const eval::Constant_AST_Node<T> &>(*child.children[0]).m_value;
+              if (!label.get_type_info().bare_equal(user_type<Key>())) {
+                return node;
+              }
+
+              // the first of several equal labels is the one the sequential comparison would hit
+              cases.emplace(*static_cast<const Key *>(label.get_const_ptr()), i);
+            }
+          }
+
+          return chaiscript::make_unique<eval::AST_Node_Impl<T>, eval::Constant_Switch_AST_Node<T, Key>>(node->text, node->location,
+              std::move(node->children), std::move(cases), default_case);
+        }
+    };
+
+    typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, optimizer::Constant_Arg_Call,
+      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop, optimizer::Assign_Decl, optimizer::Switch> Optimizer_Default; 
 
   }
 }
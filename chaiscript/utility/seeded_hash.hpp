@@ -0,0 +1,47 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_UTILITY_SEEDED_HASH_HPP_
+#define CHAISCRIPT_UTILITY_SEEDED_HASH_HPP_
+
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "../../hash.hpp"
+
+
+namespace chaiscript
+{
+  namespace utility
+  {
+    /// Drop-in for std::hash in containers that scripts share, backed by the interpreter's
+    /// seeded hash (zachlisp::hash) so both sides use one implementation and one seed.
+    /// Strings are hashed byte by byte; any other key has its std::hash rehashed, which
+    /// spreads keys such as integers that std::hash leaves as they are.
+    template<typename Key>
+      struct Seeded_Hash
+      {
+        std::size_t operator()(const Key &t_key) const noexcept
+        {
+          return zachlisp::hash::integer(static_cast<std::uint64_t>(std::hash<Key>()(t_key)));
+        }
+      };
+
+    template<>
+      struct Seeded_Hash<std::string>
+      {
+        std::size_t operator()(const std::string &t_key) const noexcept
+        {
+          return zachlisp::hash::string(t_key);
+        }
+      };
+  }
+}
+
+#endif
@@ -0,0 +1,1416 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "btree.hpp"
+#include "flat_map.hpp"
+#include "hash.hpp"
+#include "memo.hpp"
+#include "parallel.hpp"
+#include "re.hpp"
+#include "sort.hpp"
+#include "chaiscript/chaiscript.hpp"
+
+namespace zachlisp {
+
+    // zachlisp::core
+    // native functions that zachlisp code can call. lisp names are munged to chai
+    // identifiers by the evaluator, so sorted-map is registered as sorted_map
+    namespace core {
+
+    using chaiscript::Boxed_Value;
+
+    // the one copy of a keyword's or symbol's name
+    const std::string* intern(const std::string & name) {
+        static std::mutex mutex;
+        static std::unordered_set<std::string, hash::String_Hash> names;
+        std::lock_guard<std::mutex> lock(mutex);
+        return &*names.insert(name).first;
+    }
+
+    // an interned name like :x; keywords with the same name share one string,
+    // so they are compared by pointer
+    struct Keyword {
+        const std::string* name;
+
+        static Keyword intern(const std::string & name) {
+            return Keyword{core::intern(name)};
+        }
+
+        bool operator==(const Keyword & k) const {
+            return name == k.name;
+        }
+    };
+
+    // a symbol as data, made by quoting it; interned like keywords
+    struct Symbol {
+        const std::string* name;
+
+        static Symbol intern(const std::string & name) {
+            return Symbol{core::intern(name)};
+        }
+
+        bool operator==(const Symbol & s) const {
+            return name == s.name;
+        }
+    };
+
+    // a list as data, made by quoting it. stored like a vector, printed with parentheses
+    struct List {
+        std::vector<Boxed_Value> items;
+    };
+
+    // a set, made by a #{...} literal. like a map, it keys each item by its printed form,
+    // with the item itself as the value. being its own type keeps a map whose keys equal
+    // their values, such as (frequencies [1 2 2]), from printing as a set
+    struct Hash_Set {
+        std::map<std::string, Boxed_Value> items;
+    };
+
+    // the & rest of a destructured sequence or a variadic call, printed as a list, so taking
+    // it copies nothing. it views the items [begin, end) of owner, which is a vector, a list or
+    // other rest arguments. it keeps owner alive, and finds owner's items again on every use,
+    // since push_back can move them; items pushed after the view was taken aren't in it.
+    // a call's arguments have no owner: args points at them only while the call runs, so the
+    // function materialises the view if it is still referenced when the call returns
+    struct Rest_Args {
+        Boxed_Value owner;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        const Boxed_Value* args = nullptr;
+        std::vector<Boxed_Value> owned;
+        bool materialised = false;
+
+        // points first and last at the items in view
+        void items(const Boxed_Value* & first, const Boxed_Value* & last) const;
+
+        std::size_t size() const {
+            const Boxed_Value* first;
+            const Boxed_Value* last;
+            items(first, last);
+            return last - first;
+        }
+
+        void materialise() {
+            const Boxed_Value* first;
+            const Boxed_Value* last;
+            items(first, last);
+            owned.assign(first, last);
+            owner = Boxed_Value();
+            args = nullptr;
+            materialised = true;
+        }
+    };
+
+    // points first and last at the items of a vector, list or rest arguments; nil has none.
+    // false for anything else
+    bool items(const Boxed_Value & v, const Boxed_Value* & first, const Boxed_Value* & last) {
+        const auto & type = v.get_type_info();
+        const std::vector<Boxed_Value>* vec = nullptr;
+        if (v.is_null()) {
+            first = last = nullptr;
+            return true;
+        } else if (type.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>())) {
+            vec = &chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(v);
+        } else if (type.bare_equal(chaiscript::user_type<List>())) {
+            vec = &chaiscript::boxed_cast<const List &>(v).items;
+        } else if (type.bare_equal(chaiscript::user_type<Rest_Args>())) {
+            chaiscript::boxed_cast<const Rest_Args &>(v).items(first, last);
+            return true;
+        } else {
+            return false;
+        }
+        first = vec->data();
+        last = first + vec->size();
+        return true;
+    }
+
+    void Rest_Args::items(const Boxed_Value* & first, const Boxed_Value* & last) const {
+        if (materialised) {
+            first = owned.data();
+            last = first + owned.size();
+            return;
+        }
+        if (args) {
+            first = args + begin;
+            last = args + end;
+            return;
+        }
+        // a view of a view reads through it, so materialising the outer one is enough
+        core::items(owner, first, last);
+        const std::size_t size = last - first;
+        last = first + std::min(end, size);
+        first += std::min(begin, size);
+    }
+
+    // a deep copy of a value, for values kept past the call that made them: quoted
+    // constants, the keys of sorted maps and sets, and memoized arguments and results.
+    // changing the original, as (push_back v 3) does, can't change the copy. nil,
+    // functions and the interned symbols and keywords can't be changed and are shared
+    Boxed_Value copy(const Boxed_Value & bv) {
+        const auto & type = bv.get_type_info();
+        if (type.bare_equal(chaiscript::user_type<long>())) {
+            return Boxed_Value(*static_cast<const long*>(bv.get_const_ptr()));
+        } else if (type.bare_equal(chaiscript::user_type<double>())) {
+            return Boxed_Value(*static_cast<const double*>(bv.get_const_ptr()));
+        } else if (type.is_arithmetic()) {
+            return chaiscript::Boxed_Number::clone(bv);
+        } else if (type.bare_equal(chaiscript::user_type<bool>())) {
+            return Boxed_Value(chaiscript::boxed_cast<bool>(bv));
+        } else if (type.bare_equal(chaiscript::user_type<std::string>())) {
+            return Boxed_Value(chaiscript::boxed_cast<const std::string &>(bv));
+        } else if (type.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>())) {
+            const auto & vec = chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(bv);
+            std::vector<Boxed_Value> ret;
+            ret.reserve(vec.size());
+            for (const auto & item : vec) {
+                ret.push_back(copy(item));
+            }
+            return Boxed_Value(std::move(ret));
+        } else if (type.bare_equal(chaiscript::user_type<List>())) {
+            const auto & list = chaiscript::boxed_cast<const List &>(bv);
+            std::vector<Boxed_Value> ret;
+            ret.reserve(list.items.size());
+            for (const auto & item : list.items) {
+                ret.push_back(copy(item));
+            }
+            return Boxed_Value(List{std::move(ret)});
+        } else if (type.bare_equal(chaiscript::user_type<std::map<std::string, Boxed_Value>>())) {
+            std::map<std::string, Boxed_Value> ret;
+            for (const auto & entry : chaiscript::boxed_cast<const std::map<std::string, Boxed_Value> &>(bv)) {
+                ret.emplace_hint(ret.end(), entry.first, copy(entry.second));
+            }
+            return Boxed_Value(std::move(ret));
+        } else if (type.bare_equal(chaiscript::user_type<Hash_Set>())) {
+            Hash_Set ret;
+            for (const auto & entry : chaiscript::boxed_cast<const Hash_Set &>(bv).items) {
+                ret.items.emplace_hint(ret.items.end(), entry.first, copy(entry.second));
+            }
+            return Boxed_Value(std::move(ret));
+        }
+        return bv;
+    }
+
+    // calls a function value with any number of arguments
+    Boxed_Value call(chaiscript::ChaiScript & chai, const Boxed_Value & f, const chaiscript::Function_Params & args) {
+        return chai.call_function(chai.boxed_cast<const chaiscript::dispatch::Proxy_Function_Base &>(f), args);
+    }
+
+    // (apply f x1 x2 ... coll)
+    // calls f with the xs followed by the items of coll. the items are copied into the
+    // argument array: f could push_back to coll and move them while it runs
+    Boxed_Value apply(chaiscript::ChaiScript & chai, const chaiscript::Function_Params & params) {
+        const Boxed_Value* first;
+        const Boxed_Value* last;
+        if (params.size() < 2 || !items(params[params.size() - 1], first, last)) {
+            throw std::invalid_argument("apply takes a function, optional arguments and a sequence");
+        }
+        std::vector<Boxed_Value> args(params.begin() + 1, params.end() - 1);
+        args.insert(args.end(), first, last);
+        return call(chai, params[0], chaiscript::Function_Params(args));
+    }
+
+    // the field layout shared by all records of a defrecord type
+    struct Record_Type {
+        std::string name;
+        std::vector<Keyword> fields;
+    };
+
+    // a record keeps its fields in slots in declaration order. keys assoc'ed
+    // onto it that aren't fields go into an overflow list
+    struct Record {
+        std::shared_ptr<const Record_Type> type;
+        std::vector<Boxed_Value> slots;
+        std::vector<std::pair<Keyword, Boxed_Value>> overflow;
+
+        // index of the field's slot, or -1
+        int slot(const Keyword & k) const {
+            const auto & fields = type->fields;
+            for (std::size_t i = 0; i < fields.size(); i++) {
+                if (fields[i] == k) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        // whether a cached slot guess is the field's slot
+        bool guessed(const Keyword & k, std::size_t guess) const {
+            return guess < slots.size() && type->fields[guess] == k;
+        }
+
+        // field lookup that starts at a cached slot guess and updates the guess on a miss
+        const Boxed_Value* find(const Keyword & k, std::atomic<std::size_t> & guess) const {
+            const auto i = guess.load(std::memory_order_relaxed);
+            if (guessed(k, i)) {
+                return &slots[i];
+            }
+            const auto found = slot(k);
+            if (found >= 0) {
+                guess.store(found, std::memory_order_relaxed);
+                return &slots[found];
+            }
+            for (const auto & e : overflow) {
+                if (e.first == k) {
+                    return &e.second;
+                }
+            }
+            return nullptr;
+        }
+
+        const Boxed_Value* find(const Keyword & k) const {
+            std::atomic<std::size_t> guess{0};
+            return find(k, guess);
+        }
+
+        Record assoc(const Keyword & k, const Boxed_Value & v) const {
+            Record r(*this);
+            const auto i = slot(k);
+            if (i >= 0) {
+                r.slots[i] = v;
+                return r;
+            }
+            for (auto & e : r.overflow) {
+                if (e.first == k) {
+                    e.second = v;
+                    return r;
+                }
+            }
+            r.overflow.emplace_back(k, v);
+            return r;
+        }
+    };
+
+    std::string kind(const chaiscript::Type_Info & ti) {
+        if (ti.bare_equal(chaiscript::user_type<bool>())) {
+            return "boolean";
+        } else if (ti.is_arithmetic()) {
+            return "number";
+        } else if (ti.bare_equal(chaiscript::user_type<std::string>())) {
+            return "string";
+        } else if (ti.bare_equal(chaiscript::user_type<Keyword>())) {
+            return "keyword";
+        } else if (ti.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>())) {
+            return "vector";
+        }
+        return "object";
+    }
+
+    // a number held exactly: integers as 64-bit integers, everything else as a double
+    struct Exact_Number {
+        enum Kind {SIGNED, UNSIGNED, FLOATING};
+
+        Kind kind;
+        std::int64_t i = 0;
+        std::uint64_t u = 0;
+        double d = 0;
+
+        explicit Exact_Number(const Boxed_Value & v) {
+            const auto & t = v.get_type_info();
+            const chaiscript::Boxed_Number n(v);
+            if (chaiscript::Boxed_Number::is_floating_point(v)) {
+                kind = FLOATING;
+                d = n.get_as<double>();
+            } else if (t.bare_equal(chaiscript::user_type<unsigned long>()) || t.bare_equal(chaiscript::user_type<unsigned long long>())
+                       || t.bare_equal(chaiscript::user_type<unsigned int>())) {
+                kind = UNSIGNED;
+                u = n.get_as<std::uint64_t>();
+            } else {
+                kind = SIGNED;
+                i = n.get_as<std::int64_t>();
+            }
+        }
+    };
+
+    template <class T>
+    int three_way(const T & a, const T & b) {
+        return a < b ? -1 : b < a ? 1 : 0;
+    }
+
+    // an unsigned integer against a double that isn't NaN
+    int compare_exact(std::uint64_t u, double d) {
+        if (d < 0) {
+            return 1;
+        }
+        if (d >= 18446744073709551616.0) {
+            return -1;
+        }
+        const double whole = std::trunc(d);
+        if (const auto c = three_way(u, static_cast<std::uint64_t>(whole))) {
+            return c;
+        }
+        return whole < d ? -1 : 0;
+    }
+
+    // a signed integer against a double that isn't NaN
+    int compare_exact(std::int64_t i, double d) {
+        if (i >= 0) {
+            return compare_exact(static_cast<std::uint64_t>(i), d);
+        }
+        if (d >= 0) {
+            return -1;
+        }
+        // both negative: compare magnitudes the other way round
+        return -compare_exact(static_cast<std::uint64_t>(-(i + 1)) + 1, -d);
+    }
+
+    // numbers by value, exactly: integers past 2^53 aren't rounded to doubles to compare
+    // them with doubles. NaN equals itself and sorts after every other number, which keeps
+    // sorting a strict weak ordering
+    int compare_numbers(const Boxed_Value & a, const Boxed_Value & b) {
+        const Exact_Number x(a);
+        const Exact_Number y(b);
+        if (x.kind == Exact_Number::FLOATING || y.kind == Exact_Number::FLOATING) {
+            const bool x_nan = x.kind == Exact_Number::FLOATING && std::isnan(x.d);
+            const bool y_nan = y.kind == Exact_Number::FLOATING && std::isnan(y.d);
+            if (x_nan || y_nan) {
+                return x_nan - y_nan;
+            }
+        }
+        switch (x.kind) {
+            case Exact_Number::SIGNED:
+                switch (y.kind) {
+                    case Exact_Number::SIGNED:
+                        return three_way(x.i, y.i);
+                    case Exact_Number::UNSIGNED:
+                        return x.i < 0 ? -1 : three_way(static_cast<std::uint64_t>(x.i), y.u);
+                    case Exact_Number::FLOATING:
+                        return compare_exact(x.i, y.d);
+                }
+                break;
+            case Exact_Number::UNSIGNED:
+                switch (y.kind) {
+                    case Exact_Number::SIGNED:
+                        return y.i < 0 ? 1 : three_way(x.u, static_cast<std::uint64_t>(y.i));
+                    case Exact_Number::UNSIGNED:
+                        return three_way(x.u, y.u);
+                    case Exact_Number::FLOATING:
+                        return compare_exact(x.u, y.d);
+                }
+                break;
+            case Exact_Number::FLOATING:
+                switch (y.kind) {
+                    case Exact_Number::SIGNED:
+                        return -compare_exact(y.i, x.d);
+                    case Exact_Number::UNSIGNED:
+                        return -compare_exact(y.u, x.d);
+                    case Exact_Number::FLOATING:
+                        return three_way(x.d, y.d);
+                }
+                break;
+        }
+        return 0;
+    }
+
+    // total order over the values sorted collections accept: false before true,
+    // numbers by value, strings, keywords and vectors lexicographically
+    int compare(const Boxed_Value & a, const Boxed_Value & b) {
+        const auto & ta = a.get_type_info();
+        const auto & tb = b.get_type_info();
+        if (ta.bare_equal(chaiscript::user_type<bool>()) && tb.bare_equal(chaiscript::user_type<bool>())) {
+            return chaiscript::boxed_cast<bool>(a) - chaiscript::boxed_cast<bool>(b);
+        }
+        if (ta.is_arithmetic() && tb.is_arithmetic()) {
+            return compare_numbers(a, b);
+        }
+        if (ta.bare_equal(chaiscript::user_type<std::string>()) && tb.bare_equal(chaiscript::user_type<std::string>())) {
+            return chaiscript::boxed_cast<const std::string &>(a).compare(chaiscript::boxed_cast<const std::string &>(b));
+        }
+        if (ta.bare_equal(chaiscript::user_type<Keyword>()) && tb.bare_equal(chaiscript::user_type<Keyword>())) {
+            return chaiscript::boxed_cast<const Keyword &>(a).name->compare(*chaiscript::boxed_cast<const Keyword &>(b).name);
+        }
+        if (ta.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>()) && tb.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>())) {
+            const auto & va = chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(a);
+            const auto & vb = chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(b);
+            for (std::size_t i = 0; i < va.size() && i < vb.size(); i++) {
+                if (auto c = compare(va[i], vb[i])) {
+                    return c;
+                }
+            }
+            return va.size() < vb.size() ? -1 : va.size() > vb.size() ? 1 : 0;
+        }
+        throw std::invalid_argument("Can't compare " + kind(ta) + " with " + kind(tb));
+    }
+
+    struct Boxed_Less {
+        bool operator()(const Boxed_Value & a, const Boxed_Value & b) const {
+            return compare(a, b) < 0;
+        }
+    };
+
+    using Sorted_Map = btree::Map<Boxed_Value, Boxed_Value, Boxed_Less>;
+
+    // a sorted map whose values are unused
+    struct Sorted_Set {
+        Sorted_Map map;
+    };
+
+    // a sorted map or set keeps its own copy of each key, so changing the key the caller
+    // passed in can't reorder the tree under it
+    Sorted_Map assoc(const Sorted_Map & m, const Boxed_Value & k, const Boxed_Value & v) {
+        return m.assoc(copy(k), v);
+    }
+
+    Sorted_Set conj(const Sorted_Set & s, const Boxed_Value & x) {
+        const auto key = copy(x);
+        return Sorted_Set{s.map.assoc(key, key)};
+    }
+
+    Boxed_Value entry(const Sorted_Map::Entry & e) {
+        return Boxed_Value(std::vector<Boxed_Value>{e.first, e.second});
+    }
+
+    // (sorted-map k1 v1 k2 v2 ...)
+    Boxed_Value sorted_map(const chaiscript::Function_Params & params) {
+        if (params.size() % 2 != 0) {
+            throw std::invalid_argument("sorted-map takes an even number of arguments");
+        }
+        Sorted_Map m;
+        for (std::size_t i = 0; i < params.size(); i += 2) {
+            m = assoc(m, params[i], params[i + 1]);
+        }
+        return Boxed_Value(m);
+    }
+
+    // (sorted-set x1 x2 ...)
+    Boxed_Value sorted_set(const chaiscript::Function_Params & params) {
+        Sorted_Set s;
+        for (const auto & x : params) {
+            s = conj(s, x);
+        }
+        return Boxed_Value(s);
+    }
+
+    Boxed_Value get(const Sorted_Map & m, const Boxed_Value & key, const Boxed_Value & not_found) {
+        auto value = m.find(key);
+        return value ? *value : not_found;
+    }
+
+    // in-order entries, as [k v] vectors for maps and keys for sets, with lo <= key < hi
+    // when bounds are given
+    std::vector<Boxed_Value> entries(const Sorted_Map & m, const Boxed_Value* lo, const Boxed_Value* hi) {
+        std::vector<Boxed_Value> ret;
+        m.for_each(lo, hi, [&](const Sorted_Map::Entry & e) { ret.push_back(entry(e)); return true; });
+        return ret;
+    }
+
+    std::vector<Boxed_Value> keys(const Sorted_Set & s, const Boxed_Value* lo, const Boxed_Value* hi) {
+        std::vector<Boxed_Value> ret;
+        s.map.for_each(lo, hi, [&](const Sorted_Map::Entry & e) { ret.push_back(e.first); return true; });
+        return ret;
+    }
+
+    // the constructor of a record type, taking one argument per field
+    chaiscript::Proxy_Function record_constructor(std::shared_ptr<const Record_Type> type) {
+        return chaiscript::dispatch::make_dynamic_proxy_function(
+            [type](const chaiscript::Function_Params & params) {
+                if (params.size() != type->fields.size()) {
+                    throw std::invalid_argument(type->name + " takes " + std::to_string(type->fields.size()) + " arguments");
+                }
+                return Boxed_Value(Record{type, params.to_vector(), {}});
+            });
+    }
+
+    std::vector<Boxed_Value> entries(const Record & r) {
+        std::vector<Boxed_Value> ret;
+        for (std::size_t i = 0; i < r.slots.size(); i++) {
+            ret.push_back(Boxed_Value(std::vector<Boxed_Value>{Boxed_Value(r.type->fields[i]), r.slots[i]}));
+        }
+        for (const auto & e : r.overflow) {
+            ret.push_back(Boxed_Value(std::vector<Boxed_Value>{Boxed_Value(e.first), e.second}));
+        }
+        return ret;
+    }
+
+    // everything but nil and false is true
+    bool truthy(const Boxed_Value & v) {
+        return !v.is_null() && !(v.get_type_info().bare_equal(chaiscript::user_type<bool>()) && !chaiscript::boxed_cast<bool>(v));
+    }
+
+    // a stage of a reduction. inputs are pushed through a chain of reducers, each passing
+    // what it makes of them to the next, so a pipeline makes one pass over its input and
+    // builds no collections between stages
+    struct Reducer {
+        virtual ~Reducer() = default;
+
+        // false once the reduction should stop
+        virtual bool step(const Boxed_Value & input) = 0;
+
+        // called once at the end, to pass on anything held back
+        virtual void complete() {}
+    };
+
+    using Reducer_Ptr = std::unique_ptr<Reducer>;
+
+    // a reducer that passes its inputs on to another
+    struct Stage : Reducer {
+        explicit Stage(Reducer_Ptr n) : next(std::move(n)) {}
+
+        void complete() override {
+            next->complete();
+        }
+
+        Reducer_Ptr next;
+    };
+
+    // a transformation of reductions, as made by (map f), (filter f), (take n) and
+    // (partition-all n). it wraps the reducer that receives its output, and each
+    // reduction gets fresh stages so state like take's count isn't shared
+    struct Transducer {
+        std::function<Reducer_Ptr(Reducer_Ptr)> wrap;
+    };
+
+    Transducer map_xf(chaiscript::ChaiScript & chai, const Boxed_Value & f) {
+        struct Map : Stage {
+            Map(Reducer_Ptr n, chaiscript::ChaiScript & c, Boxed_Value fn) : Stage(std::move(n)), chai(c), f(fn) {}
+
+            bool step(const Boxed_Value & input) override {
+                return next->step(call(chai, f, chaiscript::Function_Params(input)));
+            }
+
+            chaiscript::ChaiScript & chai;
+            Boxed_Value f;
+        };
+        return Transducer{[&chai, f](Reducer_Ptr next) -> Reducer_Ptr { return std::make_unique<Map>(std::move(next), chai, f); }};
+    }
+
+    Transducer filter_xf(chaiscript::ChaiScript & chai, const Boxed_Value & f) {
+        struct Filter : Stage {
+            Filter(Reducer_Ptr n, chaiscript::ChaiScript & c, Boxed_Value fn) : Stage(std::move(n)), chai(c), f(fn) {}
+
+            bool step(const Boxed_Value & input) override {
+                return !truthy(call(chai, f, chaiscript::Function_Params(input))) || next->step(input);
+            }
+
+            chaiscript::ChaiScript & chai;
+            Boxed_Value f;
+        };
+        return Transducer{[&chai, f](Reducer_Ptr next) -> Reducer_Ptr { return std::make_unique<Filter>(std::move(next), chai, f); }};
+    }
+
+    Transducer take_xf(long n) {
+        struct Take : Stage {
+            Take(Reducer_Ptr next, long n) : Stage(std::move(next)), left(n) {}
+
+            bool step(const Boxed_Value & input) override {
+                if (left <= 0) {
+                    return false;
+                }
+                return next->step(input) && --left > 0;
+            }
+
+            long left;
+        };
+        return Transducer{[n](Reducer_Ptr next) -> Reducer_Ptr { return std::make_unique<Take>(std::move(next), n); }};
+    }
+
+    Transducer partition_all_xf(long n) {
+        if (n < 1) {
+            throw std::invalid_argument("partition-all needs a positive size");
+        }
+        struct Partition_All : Stage {
+            Partition_All(Reducer_Ptr next, std::size_t n) : Stage(std::move(next)), size(n) {
+                part.reserve(size);
+            }
+
+            bool step(const Boxed_Value & input) override {
+                part.push_back(input);
+                if (part.size() < size) {
+                    return true;
+                }
+                return flush();
+            }
+
+            void complete() override {
+                if (!part.empty()) {
+                    flush();
+                }
+                next->complete();
+            }
+
+            bool flush() {
+                std::vector<Boxed_Value> full;
+                full.reserve(size);
+                full.swap(part);
+                return next->step(Boxed_Value(std::move(full)));
+            }
+
+            std::size_t size;
+            std::vector<Boxed_Value> part;
+        };
+        return Transducer{[n](Reducer_Ptr next) -> Reducer_Ptr { return std::make_unique<Partition_All>(std::move(next), n); }};
+    }
+
+    // (comp xf1 xf2 ...)
+    // a transducer that applies xf1's transformation first
+    Boxed_Value comp(const chaiscript::Function_Params & params) {
+        std::vector<Transducer> xfs;
+        for (const auto & p : params) {
+            xfs.push_back(chaiscript::boxed_cast<const Transducer &>(p));
+        }
+        return Boxed_Value(Transducer{[xfs](Reducer_Ptr next) {
+            for (auto it = xfs.rbegin(); it != xfs.rend(); ++it) {
+                next = it->wrap(std::move(next));
+            }
+            return next;
+        }});
+    }
+
+    // pushes the items of coll through reducer until it stops
+    void reduce(const Boxed_Value & coll, Reducer & reducer) {
+        const Boxed_Value* first;
+        const Boxed_Value* last;
+        if (items(coll, first, last)) {
+            while (first != last && reducer.step(*first++)) {}
+        } else if (coll.get_type_info().bare_equal(chaiscript::user_type<Sorted_Set>())) {
+            chaiscript::boxed_cast<const Sorted_Set &>(coll).map.for_each([&](const Sorted_Map::Entry & e) { return reducer.step(e.first); });
+        } else if (coll.get_type_info().bare_equal(chaiscript::user_type<Sorted_Map>())) {
+            chaiscript::boxed_cast<const Sorted_Map &>(coll).for_each([&](const Sorted_Map::Entry & e) { return reducer.step(entry(e)); });
+        } else {
+            throw std::invalid_argument("Can't reduce over a " + kind(coll.get_type_info()));
+        }
+        reducer.complete();
+    }
+
+    // (transduce xform f init coll)
+    // reduces coll with (f acc x) after transforming it with xform
+    Boxed_Value transduce(chaiscript::ChaiScript & chai, const Transducer & xf, const Boxed_Value & f, const Boxed_Value & init, const Boxed_Value & coll) {
+        struct Call : Reducer {
+            Call(chaiscript::ChaiScript & c, Boxed_Value fn, Boxed_Value init) : chai(c), f(fn), acc(init) {}
+
+            bool step(const Boxed_Value & input) override {
+                const std::array<Boxed_Value, 2> args{{acc, input}};
+                acc = call(chai, f, chaiscript::Function_Params(args));
+                return true;
+            }
+
+            chaiscript::ChaiScript & chai;
+            Boxed_Value f;
+            Boxed_Value acc;
+        };
+        auto last = std::make_unique<Call>(chai, f, init);
+        auto & result = last->acc;
+        auto reducer = xf.wrap(std::move(last));
+        reduce(coll, *reducer);
+        return result;
+    }
+
+    // (into to xform from) or (into to from)
+    // adds the items of from, transformed by xform, to a vector or sorted set. the
+    // items are appended to the new collection directly, without calling back into chai
+    Boxed_Value into(const Boxed_Value & to, const Transducer* xf, const Boxed_Value & from) {
+        struct Append : Reducer {
+            bool step(const Boxed_Value & input) override {
+                vec.push_back(input);
+                return true;
+            }
+
+            std::vector<Boxed_Value> vec;
+        };
+        struct Conj : Reducer {
+            bool step(const Boxed_Value & input) override {
+                set = conj(set, input);
+                return true;
+            }
+
+            Sorted_Set set;
+        };
+
+        // returns the chain so the last reducer's result outlives the reduction
+        auto run = [&](Reducer_Ptr last) {
+            auto reducer = xf ? xf->wrap(std::move(last)) : std::move(last);
+            reduce(from, *reducer);
+            return reducer;
+        };
+        if (to.get_type_info().bare_equal(chaiscript::user_type<Sorted_Set>())) {
+            auto conj = std::make_unique<Conj>();
+            auto & set = conj->set;
+            set = chaiscript::boxed_cast<const Sorted_Set &>(to);
+            const auto reducer = run(std::move(conj));
+            return Boxed_Value(set);
+        }
+
+        const Boxed_Value* first;
+        const Boxed_Value* last;
+        if (!items(to, first, last)) {
+            throw std::invalid_argument("into takes a vector or a sorted set");
+        }
+        auto append = std::make_unique<Append>();
+        auto & vec = append->vec;
+        vec.assign(first, last);
+        const auto reducer = run(std::move(append));
+        return Boxed_Value(std::move(vec));
+    }
+
+    // (sort coll), (sort comp coll), (sort-by keyfn coll) or (sort-by keyfn comp coll)
+    // a stable sort into a new vector. keyfn is called once per item, and the keys are
+    // copied into a typed array when they are all longs, all doubles or all strings, so
+    // only a custom comparator calls back into chai while sorting. any other mix, such as
+    // longs with doubles, is ordered by compare
+    Boxed_Value sort_items(chaiscript::ChaiScript & chai, const Boxed_Value* keyfn, const Boxed_Value* comp, const Boxed_Value & coll) {
+        const Boxed_Value* first;
+        const Boxed_Value* last;
+        if (!items(coll, first, last)) {
+            throw std::invalid_argument("Can't sort a " + kind(coll.get_type_info()));
+        }
+        const std::size_t n = last - first;
+
+        std::vector<Boxed_Value> extracted;
+        const Boxed_Value* keys = first;
+        if (keyfn) {
+            extracted.reserve(n);
+            for (auto it = first; it != last; ++it) {
+                extracted.push_back(call(chai, *keyfn, chaiscript::Function_Params(*it)));
+            }
+            keys = extracted.data();
+        }
+
+        std::vector<std::size_t> order;
+        auto sort_keyed = [&](auto keyed, auto less) {
+            for (std::size_t i = 0; i < n; i++) {
+                keyed[i].second = i;
+            }
+            sort::parallel_sort(keyed, less);
+            for (const auto & k : keyed) {
+                order.push_back(k.second);
+            }
+        };
+        auto all = [&](auto pred) { return std::all_of(keys, keys + n, pred); };
+        auto is_number = [](const Boxed_Value & k) {
+            return k.get_type_info().is_arithmetic() && !k.get_type_info().bare_equal(chaiscript::user_type<bool>());
+        };
+        auto is_string = [](const Boxed_Value & k) { return k.get_type_info().bare_equal(chaiscript::user_type<std::string>()); };
+        order.reserve(n);
+
+        if (comp) {
+            for (std::size_t i = 0; i < n; i++) {
+                order.push_back(i);
+            }
+            // a comparator may return a boolean, or a number that is negative when a < b
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+                const std::array<Boxed_Value, 2> args{{keys[a], keys[b]}};
+                const auto ret = call(chai, *comp, chaiscript::Function_Params(args));
+                if (is_number(ret)) {
+                    return chaiscript::Boxed_Number(ret).get_as<double>() < 0;
+                }
+                return truthy(ret);
+            });
+        } else if (all([](const Boxed_Value & k) { return k.get_type_info().bare_equal(chaiscript::user_type<long>()); })) {
+            std::vector<sort::Keyed<std::int64_t>> keyed(n);
+            for (std::size_t i = 0; i < n; i++) {
+                keyed[i] = {chaiscript::Boxed_Number(keys[i]).get_as<std::int64_t>(), i};
+            }
+            sort::radix_sort(keyed);
+            for (const auto & k : keyed) {
+                order.push_back(k.second);
+            }
+        } else if (all([&](const Boxed_Value & k) { return is_number(k) && chaiscript::Boxed_Number::is_floating_point(k); })) {
+            std::vector<sort::Keyed<double>> keyed(n);
+            for (std::size_t i = 0; i < n; i++) {
+                keyed[i].first = chaiscript::Boxed_Number(keys[i]).get_as<double>();
+            }
+            // NaN goes last, as compare puts it
+            sort_keyed(std::move(keyed), [](const sort::Keyed<double> & a, const sort::Keyed<double> & b) {
+                return !std::isnan(a.first) && (std::isnan(b.first) || a.first < b.first);
+            });
+        } else if (all(is_string)) {
+            std::vector<sort::Keyed<const std::string*>> keyed(n);
+            for (std::size_t i = 0; i < n; i++) {
+                keyed[i].first = &chaiscript::boxed_cast<const std::string &>(keys[i]);
+            }
+            sort_keyed(std::move(keyed), [](const sort::Keyed<const std::string*> & a, const sort::Keyed<const std::string*> & b) { return *a.first < *b.first; });
+        } else {
+            std::vector<sort::Keyed<const Boxed_Value*>> keyed(n);
+            for (std::size_t i = 0; i < n; i++) {
+                keyed[i].first = keys + i;
+            }
+            sort_keyed(std::move(keyed), [](const sort::Keyed<const Boxed_Value*> & a, const sort::Keyed<const Boxed_Value*> & b) { return compare(*a.first, *b.first) < 0; });
+        }
+
+        std::vector<Boxed_Value> sorted;
+        sorted.reserve(n);
+        for (auto i : order) {
+            sorted.push_back(first[i]);
+        }
+        return Boxed_Value(std::move(sorted));
+    }
+
+    // the kinds of value that hash and equal tell apart. they match how values print, so
+    // two values are equal exactly when they would make the same map key
+    enum class Shape {NIL, BOOL, INTEGER, FLOAT, STRING, KEYWORD, SYMBOL, VECTOR, LIST, MAP, SET, RECORD, SORTED_MAP, SORTED_SET, OTHER};
+
+    Shape shape(const Boxed_Value & v) {
+        const auto & type = v.get_type_info();
+        if (v.is_null()) {
+            return Shape::NIL;
+        } else if (type.bare_equal(chaiscript::user_type<bool>())) {
+            return Shape::BOOL;
+        } else if (type.is_arithmetic()) {
+            return chaiscript::Boxed_Number::is_floating_point(v) ? Shape::FLOAT : Shape::INTEGER;
+        } else if (type.bare_equal(chaiscript::user_type<std::string>())) {
+            return Shape::STRING;
+        } else if (type.bare_equal(chaiscript::user_type<Keyword>())) {
+            return Shape::KEYWORD;
+        } else if (type.bare_equal(chaiscript::user_type<Symbol>())) {
+            return Shape::SYMBOL;
+        } else if (type.bare_equal(chaiscript::user_type<std::vector<Boxed_Value>>())) {
+            return Shape::VECTOR;
+        } else if (type.bare_equal(chaiscript::user_type<List>()) || type.bare_equal(chaiscript::user_type<Rest_Args>())) {
+            return Shape::LIST;
+        } else if (type.bare_equal(chaiscript::user_type<std::map<std::string, Boxed_Value>>())) {
+            return Shape::MAP;
+        } else if (type.bare_equal(chaiscript::user_type<Hash_Set>())) {
+            return Shape::SET;
+        } else if (type.bare_equal(chaiscript::user_type<Record>())) {
+            return Shape::RECORD;
+        } else if (type.bare_equal(chaiscript::user_type<Sorted_Map>())) {
+            return Shape::SORTED_MAP;
+        } else if (type.bare_equal(chaiscript::user_type<Sorted_Set>())) {
+            return Shape::SORTED_SET;
+        }
+        return Shape::OTHER;
+    }
+
+    // calls f on each of a map-like value's entries in its iteration order
+    template <class F>
+    void for_each_entry(const Boxed_Value & v, Shape s, F f) {
+        if (s == Shape::MAP || s == Shape::SET) {
+            const auto & m = s == Shape::MAP ? chaiscript::boxed_cast<const std::map<std::string, Boxed_Value> &>(v)
+                                             : chaiscript::boxed_cast<const Hash_Set &>(v).items;
+            for (const auto & e : m) {
+                f(Boxed_Value(e.first), e.second);
+            }
+        } else if (s == Shape::RECORD) {
+            const auto & r = chaiscript::boxed_cast<const Record &>(v);
+            for (std::size_t i = 0; i < r.slots.size(); i++) {
+                f(Boxed_Value(r.type->fields[i]), r.slots[i]);
+            }
+            for (const auto & e : r.overflow) {
+                f(Boxed_Value(e.first), e.second);
+            }
+        } else {
+            const auto & m = s == Shape::SORTED_MAP ? chaiscript::boxed_cast<const Sorted_Map &>(v) : chaiscript::boxed_cast<const Sorted_Set &>(v).map;
+            m.for_each([&](const Sorted_Map::Entry & e) {
+                f(e.first, e.second);
+                return true;
+            });
+        }
+    }
+
+    std::size_t hash(const Boxed_Value & v) {
+        const auto s = shape(v);
+        const auto tag = static_cast<std::size_t>(s);
+        switch (s) {
+            case Shape::NIL:
+                return hash::integer(tag);
+            case Shape::BOOL:
+                return hash::integer(tag * 2 + chaiscript::boxed_cast<bool>(v));
+            case Shape::INTEGER:
+                return hash::integer(chaiscript::Boxed_Number(v).get_as<std::int64_t>());
+            case Shape::FLOAT:
+                return hash::combine(tag, hash::floating(chaiscript::Boxed_Number(v).get_as<double>()));
+            case Shape::STRING:
+                return hash::combine(tag, hash::string(chaiscript::boxed_cast<const std::string &>(v)));
+            case Shape::KEYWORD:
+                return hash::combine(tag, reinterpret_cast<std::uintptr_t>(chaiscript::boxed_cast<const Keyword &>(v).name));
+            case Shape::SYMBOL:
+                return hash::combine(tag, reinterpret_cast<std::uintptr_t>(chaiscript::boxed_cast<const Symbol &>(v).name));
+            case Shape::VECTOR:
+            case Shape::LIST:
+                {
+                    const Boxed_Value* first;
+                    const Boxed_Value* last;
+                    items(v, first, last);
+                    std::size_t h = hash::integer(tag);
+                    for (; first != last; ++first) {
+                        h = hash::combine(h, hash(*first));
+                    }
+                    return h;
+                }
+            case Shape::OTHER:
+                throw std::invalid_argument("Can't hash a " + kind(v.get_type_info()));
+            default:
+                {
+                    std::size_t h = hash::integer(tag);
+                    if (s == Shape::RECORD) {
+                        h = hash::combine(h, reinterpret_cast<std::uintptr_t>(chaiscript::boxed_cast<const Record &>(v).type.get()));
+                    }
+                    for_each_entry(v, s, [&](const Boxed_Value & key, const Boxed_Value & value) {
+                        h = hash::combine(h, hash::combine(hash(key), s == Shape::SET || s == Shape::SORTED_SET ? 0 : hash(value)));
+                    });
+                    return h;
+                }
+        }
+    }
+
+    bool equal(const Boxed_Value & a, const Boxed_Value & b) {
+        const auto s = shape(a);
+        if (s != shape(b)) {
+            return false;
+        }
+        switch (s) {
+            case Shape::NIL:
+                return true;
+            case Shape::BOOL:
+                return chaiscript::boxed_cast<bool>(a) == chaiscript::boxed_cast<bool>(b);
+            case Shape::INTEGER:
+                return chaiscript::Boxed_Number(a).get_as<std::int64_t>() == chaiscript::Boxed_Number(b).get_as<std::int64_t>();
+            case Shape::FLOAT:
+                return chaiscript::Boxed_Number(a).get_as<double>() == chaiscript::Boxed_Number(b).get_as<double>();
+            case Shape::STRING:
+                return chaiscript::boxed_cast<const std::string &>(a) == chaiscript::boxed_cast<const std::string &>(b);
+            case Shape::KEYWORD:
+                return chaiscript::boxed_cast<const Keyword &>(a) == chaiscript::boxed_cast<const Keyword &>(b);
+            case Shape::SYMBOL:
+                return chaiscript::boxed_cast<const Symbol &>(a) == chaiscript::boxed_cast<const Symbol &>(b);
+            case Shape::VECTOR:
+            case Shape::LIST:
+                {
+                    const Boxed_Value* fa;
+                    const Boxed_Value* la;
+                    const Boxed_Value* fb;
+                    const Boxed_Value* lb;
+                    items(a, fa, la);
+                    items(b, fb, lb);
+                    return la - fa == lb - fb && std::equal(fa, la, fb, equal);
+                }
+            case Shape::OTHER:
+                throw std::invalid_argument("Can't compare a " + kind(a.get_type_info()) + " for equality");
+            default:
+                {
+                    if (s == Shape::RECORD && chaiscript::boxed_cast<const Record &>(a).type != chaiscript::boxed_cast<const Record &>(b).type) {
+                        return false;
+                    }
+                    std::vector<std::pair<Boxed_Value, Boxed_Value>> ea;
+                    std::vector<std::pair<Boxed_Value, Boxed_Value>> eb;
+                    for_each_entry(a, s, [&](const Boxed_Value & k, const Boxed_Value & v) { ea.emplace_back(k, v); });
+                    for_each_entry(b, s, [&](const Boxed_Value & k, const Boxed_Value & v) { eb.emplace_back(k, v); });
+                    return ea.size() == eb.size() && std::equal(ea.begin(), ea.end(), eb.begin(), [](const auto & x, const auto & y) {
+                        return equal(x.first, y.first) && equal(x.second, y.second);
+                    });
+                }
+        }
+    }
+
+    struct Boxed_Hash {
+        std::size_t operator()(const Boxed_Value & v) const {
+            return hash(v);
+        }
+    };
+
+    struct Boxed_Equal {
+        bool operator()(const Boxed_Value & a, const Boxed_Value & b) const {
+            return equal(a, b);
+        }
+    };
+
+    template <class V>
+    using Boxed_Table = flat::Map<Boxed_Value, V, Boxed_Hash, Boxed_Equal>;
+
+    // turns a key into the string a zachlisp map stores it under
+    using Key_Printer = std::function<std::string(const Boxed_Value &)>;
+
+    // (dissoc record k). as in clojure, removing a field the record type declares leaves a
+    // plain map, and removing any other key leaves a record
+    Boxed_Value dissoc(const Key_Printer & print_key, const Record & r, const Keyword & k) {
+        const auto i = r.slot(k);
+        if (i < 0) {
+            Record ret(r);
+            ret.overflow.erase(std::remove_if(ret.overflow.begin(), ret.overflow.end(), [&k](const auto & e) { return e.first == k; }),
+                               ret.overflow.end());
+            return Boxed_Value(std::move(ret));
+        }
+        std::map<std::string, Boxed_Value> ret;
+        for (std::size_t j = 0; j < r.slots.size(); j++) {
+            if (j != static_cast<std::size_t>(i)) {
+                ret.emplace(print_key(Boxed_Value(r.type->fields[j])), r.slots[j]);
+            }
+        }
+        for (const auto & e : r.overflow) {
+            ret.emplace(print_key(Boxed_Value(e.first)), e.second);
+        }
+        return Boxed_Value(std::move(ret));
+    }
+
+    // aggregates keys[0, n) with add(value, i) into one table per thread, each over a contiguous
+    // chunk of the keys, then folds the tables into the first with merge(into, from). merging in
+    // chunk order keeps the entries in order of first occurrence
+    template <class V, class Add, class Merge>
+    Boxed_Table<V> aggregate(const Boxed_Value* keys, std::size_t n, Add add, Merge merge) {
+        const std::size_t chunks = parallel::pieces(n, std::size_t(1) << 16);
+        std::vector<Boxed_Table<V>> tables(chunks);
+        parallel::run_all(chunks, [&](std::size_t c) {
+            for (std::size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++) {
+                add(tables[c][keys[i]], i);
+            }
+        });
+        for (std::size_t c = 1; c < chunks; c++) {
+            for (auto & e : tables[c].entries()) {
+                merge(tables[0][e.first], e.second);
+            }
+        }
+        return std::move(tables[0]);
+    }
+
+    const Boxed_Value* sequence(const Boxed_Value & coll, const std::string & name, std::size_t & n) {
+        const Boxed_Value* first;
+        const Boxed_Value* last;
+        if (!items(coll, first, last)) {
+            throw std::invalid_argument(name + " takes a sequence");
+        }
+        n = last - first;
+        return first;
+    }
+
+    // (frequencies coll)
+    // a map from each distinct item to the number of times it occurs
+    Boxed_Value frequencies(const Key_Printer & print_key, const Boxed_Value & coll) {
+        std::size_t n;
+        const auto first = sequence(coll, "frequencies", n);
+        const auto table = aggregate<long>(first, n, [](long & count, std::size_t) { count++; }, [](long & into, long from) { into += from; });
+        std::map<std::string, Boxed_Value> ret;
+        for (const auto & e : table.entries()) {
+            ret.emplace(print_key(e.first), Boxed_Value(e.second));
+        }
+        return Boxed_Value(std::move(ret));
+    }
+
+    // (group-by f coll)
+    // a map from each distinct (f item) to the vector of items it came from, in order.
+    // f is called once per item, on this thread, before the keys are grouped
+    Boxed_Value group_by(chaiscript::ChaiScript & chai, const Key_Printer & print_key, const Boxed_Value & f, const Boxed_Value & coll) {
+        std::size_t n;
+        const auto first = sequence(coll, "group-by", n);
+        std::vector<Boxed_Value> keys;
+        keys.reserve(n);
+        for (std::size_t i = 0; i < n; i++) {
+            keys.push_back(call(chai, f, chaiscript::Function_Params(first[i])));
+        }
+        auto table = aggregate<std::vector<std::size_t>>(keys.data(), n,
+            [](std::vector<std::size_t> & group, std::size_t i) { group.push_back(i); },
+            [](std::vector<std::size_t> & into, std::vector<std::size_t> & from) { into.insert(into.end(), from.begin(), from.end()); });
+        std::map<std::string, Boxed_Value> ret;
+        for (const auto & e : table.entries()) {
+            std::vector<Boxed_Value> group;
+            group.reserve(e.second.size());
+            for (auto i : e.second) {
+                group.push_back(first[i]);
+            }
+            ret.emplace(print_key(e.first), Boxed_Value(std::move(group)));
+        }
+        return Boxed_Value(std::move(ret));
+    }
+
+    // (distinct coll)
+    // the items of coll without repeats, in order of first occurrence
+    Boxed_Value distinct(const Boxed_Value & coll) {
+        std::size_t n;
+        const auto first = sequence(coll, "distinct", n);
+        const auto table = aggregate<bool>(first, n, [](bool &, std::size_t) {}, [](bool &, bool) {});
+        std::vector<Boxed_Value> ret;
+        ret.reserve(table.size());
+        for (const auto & e : table.entries()) {
+            ret.push_back(e.first);
+        }
+        return Boxed_Value(std::move(ret));
+    }
+
+    // a compiled regex, from (re-pattern s)
+    struct Pattern {
+        std::shared_ptr<const re::Regex> regex;
+    };
+
+    // re- functions take a pattern or its source; sources go through re::compile's cache
+    std::shared_ptr<const re::Regex> regex(const Boxed_Value & v) {
+        if (v.get_type_info().bare_equal(chaiscript::user_type<Pattern>())) {
+            return chaiscript::boxed_cast<const Pattern &>(v).regex;
+        } else if (v.get_type_info().bare_equal(chaiscript::user_type<std::string>())) {
+            return re::compile(chaiscript::boxed_cast<const std::string &>(v));
+        }
+        throw std::invalid_argument("Expected a pattern, got a " + kind(v.get_type_info()));
+    }
+
+    // the matched string when the pattern has no groups, otherwise a vector of it and each
+    // group's match, nil for groups that didn't take part
+    Boxed_Value match_result(const re::Regex & regex, const std::string & text, const re::Captures & caps) {
+        if (caps.empty()) {
+            return Boxed_Value();
+        }
+        auto group = [&](int i) {
+            const long begin = caps[2 * i];
+            const long end = caps[2 * i + 1];
+            return begin < 0 || end < 0 ? Boxed_Value() : Boxed_Value(text.substr(begin, end - begin));
+        };
+        if (regex.groups == 0) {
+            return group(0);
+        }
+        std::vector<Boxed_Value> ret;
+        for (int i = 0; i <= regex.groups; i++) {
+            ret.push_back(group(i));
+        }
+        return Boxed_Value(std::move(ret));
+    }
+
+    // (re-find re s)
+    Boxed_Value re_find(const Boxed_Value & re, const std::string & text) {
+        const auto r = regex(re);
+        return match_result(*r, text, r->find(text, 0));
+    }
+
+    // (re-matches re s)
+    // like re-find, but the match has to cover all of s
+    Boxed_Value re_matches(const Boxed_Value & re, const std::string & text) {
+        const auto r = regex(re);
+        return match_result(*r, text, r->matches(text));
+    }
+
+    // (re-seq re s)
+    // every match in s from left to right, nil if there are none. after an empty match
+    // the search carries on one character later
+    Boxed_Value re_seq(const Boxed_Value & re, const std::string & text) {
+        const auto r = regex(re);
+        std::vector<Boxed_Value> ret;
+        std::size_t from = 0;
+        while (from <= text.size()) {
+            const auto caps = r->find(text, from);
+            if (caps.empty()) {
+                break;
+            }
+            ret.push_back(match_result(*r, text, caps));
+            from = caps[1];
+            if (caps[1] == caps[0]) {
+                do {
+                    from++;
+                } while (from < text.size() && (static_cast<unsigned char>(text[from]) & 0xc0) == 0x80);
+            }
+        }
+        return ret.empty() ? Boxed_Value() : Boxed_Value(std::move(ret));
+    }
+
+    // argument lists as memo keys, hashed and compared item by item like vectors
+    struct Args_Hash {
+        std::size_t operator()(const std::vector<Boxed_Value> & args) const {
+            std::size_t h = hash::integer(args.size());
+            for (const auto & a : args) {
+                h = hash::combine(h, hash(a));
+            }
+            return h;
+        }
+    };
+
+    struct Args_Equal {
+        bool operator()(const std::vector<Boxed_Value> & a, const std::vector<Boxed_Value> & b) const {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), Boxed_Equal());
+        }
+    };
+
+    using Memo = memo::Cache<std::vector<Boxed_Value>, Boxed_Value, Args_Hash, Args_Equal>;
+
+    const long MEMO_CAPACITY = 4096;
+
+    // the caches of live memoized functions, so memo-stats can find them. a function owns
+    // its cache; entries whose function has gone are dropped as new ones are added
+    struct Memo_Registry {
+        std::mutex mutex;
+        std::unordered_map<const chaiscript::dispatch::Proxy_Function_Base*, std::weak_ptr<Memo>> caches;
+        std::size_t prune_at = 64;
+    };
+
+    Memo_Registry & memo_registry() {
+        static Memo_Registry registry;
+        return registry;
+    }
+
+    // (memoize f) or (memoize f capacity)
+    // a function that returns what f returns, calling f only for arguments it hasn't cached.
+    // up to capacity results are kept, the least recently used going first (approximately).
+    // f is called outside any lock, so two threads missing on the same arguments may both
+    // call it, but both get back whichever result was cached first. calls with arguments
+    // that can't be hashed go straight through to f. keys are copied into the cache and
+    // results copied out of it, so changing either can't change what a later call returns
+    chaiscript::Proxy_Function memoize(chaiscript::ChaiScript & chai, const Boxed_Value & f, long capacity) {
+        if (capacity < 1) {
+            throw std::invalid_argument("memoize takes a positive capacity");
+        }
+        auto cache = std::make_shared<Memo>(static_cast<std::size_t>(capacity));
+        auto ret = chaiscript::dispatch::make_dynamic_proxy_function(
+            [&chai, f, cache](const chaiscript::Function_Params & params) {
+                const auto args = params.to_vector();
+                Boxed_Value value;
+                try {
+                    if (cache->find(args, value)) {
+                        return copy(value);
+                    }
+                } catch (const std::invalid_argument &) {
+                    return call(chai, f, params);
+                }
+                std::vector<Boxed_Value> key;
+                key.reserve(args.size());
+                for (const auto & arg : args) {
+                    key.push_back(copy(arg));
+                }
+                return copy(cache->insert(std::move(key), copy(call(chai, f, params))));
+            });
+        auto & registry = memo_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (registry.caches.size() >= registry.prune_at) {
+            for (auto it = registry.caches.begin(); it != registry.caches.end();) {
+                it = it->second.expired() ? registry.caches.erase(it) : std::next(it);
+            }
+            registry.prune_at = std::max<std::size_t>(64, registry.caches.size() * 2);
+        }
+        registry.caches[ret.get()] = cache;
+        return ret;
+    }
+
+    // (memo-stats f)
+    // the counters of a memoized function's cache
+    Boxed_Value memo_stats(const Key_Printer & print_key, const chaiscript::Const_Proxy_Function & f) {
+        std::shared_ptr<Memo> cache;
+        {
+            auto & registry = memo_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            const auto it = registry.caches.find(f.get());
+            if (it != registry.caches.end()) {
+                cache = it->second.lock();
+            }
+        }
+        if (!cache) {
+            throw std::invalid_argument("memo-stats takes a memoized function");
+        }
+        const auto stats = cache->stats();
+        std::map<std::string, Boxed_Value> ret;
+        auto put = [&](const std::string & name, std::uint64_t n) {
+            ret.emplace(print_key(Boxed_Value(Keyword::intern(":" + name))), Boxed_Value(static_cast<long>(n)));
+        };
+        put("hits", stats.hits);
+        put("misses", stats.misses);
+        put("evictions", stats.evictions);
+        put("size", stats.size);
+        put("capacity", stats.capacity);
+        return Boxed_Value(std::move(ret));
+    }
+
+    void install(chaiscript::ChaiScript & chai, Key_Printer print_key) {
+        chai.add(chaiscript::user_type<Sorted_Map>(), "SortedMap");
+        chai.add(chaiscript::user_type<Sorted_Set>(), "SortedSet");
+        chai.add(chaiscript::dispatch::make_dynamic_proxy_function(&sorted_map), "sorted_map");
+        chai.add(chaiscript::dispatch::make_dynamic_proxy_function(&sorted_set), "sorted_set");
+
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & k, const Boxed_Value & v) { return assoc(m, k, v); }), "assoc");
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & k) { return m.dissoc(k); }), "dissoc");
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & k) { return get(m, k, Boxed_Value()); }), "get");
+        chai.add(chaiscript::fun(&get), "get");
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & k) { return m.find(k) != nullptr; }), "contains");
+        chai.add(chaiscript::fun([](const Sorted_Map & m) { return static_cast<long>(m.size()); }), "count");
+        chai.add(chaiscript::fun([](const Sorted_Map & m) { return entries(m, nullptr, nullptr); }), "seq");
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & lo) { return entries(m, &lo, nullptr); }), "subseq");
+        chai.add(chaiscript::fun([](const Sorted_Map & m, const Boxed_Value & lo, const Boxed_Value & hi) { return entries(m, &lo, &hi); }), "subseq");
+
+        chai.add(chaiscript::fun([](const Sorted_Set & s, const Boxed_Value & x) { return conj(s, x); }), "conj");
+        chai.add(chaiscript::fun([](const Sorted_Set & s, const Boxed_Value & x) { return Sorted_Set{s.map.dissoc(x)}; }), "disj");
+        chai.add(chaiscript::fun([](const Sorted_Set & s, const Boxed_Value & x) { return s.map.find(x) != nullptr; }), "contains");
+        chai.add(chaiscript::fun([](const Sorted_Set & s) { return static_cast<long>(s.map.size()); }), "count");
+        chai.add(chaiscript::fun([](const Sorted_Set & s) { return keys(s, nullptr, nullptr); }), "seq");
+        chai.add(chaiscript::fun([](const Sorted_Set & s, const Boxed_Value & lo) { return keys(s, &lo, nullptr); }), "subseq");
+        chai.add(chaiscript::fun([](const Sorted_Set & s, const Boxed_Value & lo, const Boxed_Value & hi) { return keys(s, &lo, &hi); }), "subseq");
+
+        chai.add(chaiscript::user_type<Keyword>(), "Keyword");
+        chai.add(chaiscript::fun([](const Keyword & a, const Keyword & b) { return a == b; }), "==");
+        chai.add(chaiscript::fun([](const Keyword & k) { return *k.name; }), "to_string");
+
+        chai.add(chaiscript::user_type<Symbol>(), "Symbol");
+        chai.add(chaiscript::fun([](const Symbol & a, const Symbol & b) { return a == b; }), "==");
+        chai.add(chaiscript::fun([](const Symbol & s) { return *s.name; }), "to_string");
+
+        chai.add(chaiscript::user_type<List>(), "List");
+        chai.add(chaiscript::fun([](const List & l) { return static_cast<long>(l.items.size()); }), "count");
+
+        chai.add(chaiscript::user_type<Hash_Set>(), "HashSet");
+        chai.add(chaiscript::fun([](const Hash_Set & s) { return static_cast<long>(s.items.size()); }), "count");
+        chai.add(chaiscript::fun([print_key](const Hash_Set & s, const Boxed_Value & x) { return s.items.count(print_key(x)) > 0; }), "contains");
+        chai.add(chaiscript::fun([](const Hash_Set & s) {
+            std::vector<Boxed_Value> ret;
+            ret.reserve(s.items.size());
+            for (const auto & e : s.items) {
+                ret.push_back(e.second);
+            }
+            return ret;
+        }), "seq");
+
+        chai.add(chaiscript::user_type<Rest_Args>(), "RestArgs");
+        chai.add(chaiscript::fun([](const Rest_Args & r) { return static_cast<long>(r.size()); }), "count");
+
+        chai.add(chaiscript::dispatch::make_dynamic_proxy_function(
+            [&chai](const chaiscript::Function_Params & params) { return apply(chai, params); }), "apply");
+
+        // one-argument overloads beside the prelude's map(container, f) and friends
+        chai.add(chaiscript::user_type<Transducer>(), "Transducer");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & f) { return map_xf(chai, Boxed_Value(f)); }), "map");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & f) { return filter_xf(chai, Boxed_Value(f)); }), "filter");
+        chai.add(chaiscript::fun(&take_xf), "take");
+        chai.add(chaiscript::fun(&partition_all_xf), "partition_all");
+        chai.add(chaiscript::dispatch::make_dynamic_proxy_function(&comp), "comp");
+        chai.add(chaiscript::fun([&chai](const Transducer & xf, const Boxed_Value & f, const Boxed_Value & init, const Boxed_Value & coll) {
+            return transduce(chai, xf, f, init, coll);
+        }), "transduce");
+        chai.add(chaiscript::fun([](const Boxed_Value & to, const Transducer & xf, const Boxed_Value & from) { return into(to, &xf, from); }), "into");
+        chai.add(chaiscript::fun([](const Boxed_Value & to, const Boxed_Value & from) { return into(to, nullptr, from); }), "into");
+
+        chai.add(chaiscript::fun([&chai](const Boxed_Value & coll) { return sort_items(chai, nullptr, nullptr, coll); }), "sort");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & comp, const Boxed_Value & coll) {
+            const Boxed_Value c(comp);
+            return sort_items(chai, nullptr, &c, coll);
+        }), "sort");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & keyfn, const Boxed_Value & coll) {
+            const Boxed_Value k(keyfn);
+            return sort_items(chai, &k, nullptr, coll);
+        }), "sort_by");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & keyfn, const chaiscript::Const_Proxy_Function & comp, const Boxed_Value & coll) {
+            const Boxed_Value k(keyfn);
+            const Boxed_Value c(comp);
+            return sort_items(chai, &k, &c, coll);
+        }), "sort_by");
+
+        chai.add(chaiscript::fun([print_key](const Boxed_Value & coll) { return frequencies(print_key, coll); }), "frequencies");
+        chai.add(chaiscript::fun([&chai, print_key](const chaiscript::Const_Proxy_Function & f, const Boxed_Value & coll) {
+            return group_by(chai, print_key, Boxed_Value(f), coll);
+        }), "group_by");
+        chai.add(chaiscript::fun(&distinct), "distinct");
+
+        chai.add(chaiscript::user_type<Pattern>(), "Pattern");
+        chai.add(chaiscript::fun([](const std::string & source) { return Pattern{re::compile(source)}; }), "re_pattern");
+        chai.add(chaiscript::fun([](const Pattern & p) { return p; }), "re_pattern");
+        chai.add(chaiscript::fun(&re_find), "re_find");
+        chai.add(chaiscript::fun(&re_matches), "re_matches");
+        chai.add(chaiscript::fun(&re_seq), "re_seq");
+
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & f) { return memoize(chai, Boxed_Value(f), MEMO_CAPACITY); }), "memoize");
+        chai.add(chaiscript::fun([&chai](const chaiscript::Const_Proxy_Function & f, long capacity) { return memoize(chai, Boxed_Value(f), capacity); }), "memoize");
+        chai.add(chaiscript::fun([print_key](const chaiscript::Const_Proxy_Function & f) { return memo_stats(print_key, f); }), "memo_stats");
+
+        chai.add(chaiscript::user_type<Record>(), "Record");
+        chai.add(chaiscript::fun([](const Record & r, const Keyword & k) { auto v = r.find(k); return v ? *v : Boxed_Value(); }), "get");
+        chai.add(chaiscript::fun([](const Record & r, const Keyword & k, const Boxed_Value & not_found) { auto v = r.find(k); return v ? *v : not_found; }), "get");
+        chai.add(chaiscript::fun([](const Record & r, const Keyword & k, const Boxed_Value & v) { return r.assoc(k, v); }), "assoc");
+        chai.add(chaiscript::fun([print_key](const Record & r, const Keyword & k) { return dissoc(print_key, r, k); }), "dissoc");
+        chai.add(chaiscript::fun([](const Record & r, const Keyword & k) { return r.find(k) != nullptr; }), "contains");
+        chai.add(chaiscript::fun([](const Record & r) { return static_cast<long>(r.slots.size() + r.overflow.size()); }), "count");
+        chai.add(chaiscript::fun([](const Record & r) { return entries(r); }), "seq");
+    }
+
+    }
+
+}
@@ -1,9 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
 
 #include "read.hpp"
 #include "print.hpp"
+#include "metrics.hpp"
+#include "core.hpp"
 #include "chaiscript/chaiscript.hpp"
 
 namespace zachlisp {
@@ -12,8 +25,6 @@ namespace zachlisp {
 
         namespace fn {
 
-        enum Type {ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX};
-
         using Zero = std::function<chaiscript::Boxed_Value()>;
         using One = std::function<chaiscript::Boxed_Value(chaiscript::Boxed_Value)>;
         using Two = std::function<chaiscript::Boxed_Value(chaiscript::Boxed_Value, chaiscript::Boxed_Value)>;
@@ -27,11 +38,157 @@ namespace zachlisp {
     enum Type {SPECIAL, CHAI};
     using Maybe = std::variant<form::Special, chaiscript::Boxed_Value>;
 
+    // carries an error out of a lisp function that was called through chai
+    struct Error : std::runtime_error {
+        form::Special special;
+
+        explicit Error(form::Special s) : std::runtime_error(s.message), special(s) {}
+    };
+
     }
 
 const std::unordered_set<char> OPERATORS = {'+', '-', '*', '/'};
 
-chaiscript::Boxed_Value eval_token(token::Token token, chaiscript::ChaiScript* chai) {
+    // zachlisp::bench
+    namespace bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::size_t samples = 60;
+        // each sample repeats the expression until it takes at least this long,
+        // so clock resolution and loop overhead stay negligible
+        std::chrono::nanoseconds sample_time = std::chrono::milliseconds(2);
+        std::chrono::nanoseconds warmup_time = std::chrono::milliseconds(100);
+        // fewer samples are taken when the expression is too slow to fit them in this budget
+        std::chrono::nanoseconds max_time = std::chrono::seconds(10);
+    };
+
+    // times are in nanoseconds per iteration, allocation counts are per iteration
+    struct Result {
+        std::size_t samples;
+        std::size_t iterations;
+        double mean;
+        double stddev;
+        double min;
+        double p50;
+        double p90;
+        double p99;
+        double max;
+        double allocations;
+        double bytes;
+    };
+
+    // nearest-rank percentile of sorted values
+    double percentile(const std::vector<double> & sorted, double p) {
+        auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::max<std::size_t>(rank, 1) - 1];
+    }
+
+    template <class F>
+    Result run(F f, const Options & options) {
+        // warm up, doubling the batch size until one batch is long enough to time
+        std::size_t batch = 1;
+        Clock::duration elapsed;
+        const auto warmup_start = Clock::now();
+        while (true) {
+            const auto start = Clock::now();
+            for (std::size_t i = 0; i < batch; i++) {
+                f();
+            }
+            elapsed = Clock::now() - start;
+            if (elapsed < options.sample_time) {
+                batch *= 2;
+            } else if (Clock::now() - warmup_start >= options.warmup_time) {
+                break;
+            }
+        }
+
+        const double estimate = std::chrono::duration<double, std::nano>(elapsed).count() / batch;
+        const auto iterations = static_cast<std::size_t>(std::max(1.0, std::ceil(options.sample_time.count() / estimate)));
+        const auto samples = static_cast<std::size_t>(std::clamp(options.max_time.count() / (estimate * iterations), 2.0, static_cast<double>(options.samples)));
+
+        std::vector<double> times;
+        times.reserve(samples);
+        const auto counter_start = chaiscript::detail::Allocation_Counter::thread();
+        for (std::size_t s = 0; s < samples; s++) {
+            const auto start = Clock::now();
+            for (std::size_t i = 0; i < iterations; i++) {
+                f();
+            }
+            times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+        }
+        const auto counter_end = chaiscript::detail::Allocation_Counter::thread();
+
+        double sum = 0;
+        for (auto t : times) {
+            sum += t;
+        }
+        const double mean = sum / samples;
+        double squares = 0;
+        for (auto t : times) {
+            squares += (t - mean) * (t - mean);
+        }
+        std::sort(times.begin(), times.end());
+
+        const double total = static_cast<double>(samples * iterations);
+        return Result{
+            samples,
+            iterations,
+            mean,
+            std::sqrt(squares / (samples - 1)),
+            times.front(),
+            percentile(times, 0.5),
+            percentile(times, 0.9),
+            percentile(times, 0.99),
+            times.back(),
+            (counter_end.allocations - counter_start.allocations) / total,
+            (counter_end.bytes - counter_start.bytes) / total
+        };
+    }
+
+    }
+
+// lisp symbols may contain dashes, chai identifiers can't: sorted-map becomes sorted_map.
+// a dash that doesn't join two name characters, as in - or -1, is left alone
+std::string munge(std::string name) {
+    auto is_name_char = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    for (std::size_t i = 1; i + 1 < name.size(); i++) {
+        if (name[i] == '-' && is_name_char(name[i - 1]) && is_name_char(name[i + 1])) {
+            name[i] = '_';
+        }
+    }
+    return name;
+}
+
+    // zachlisp::env
+    // the local scopes made by let* and fn*. symbols are looked up from the innermost
+    // scope out, and then among chai's globals
+    namespace env {
+
+    struct Env;
+    using Ptr = std::shared_ptr<const Env>;
+
+    struct Env {
+        std::vector<std::pair<std::string, chaiscript::Boxed_Value>> vars;
+        Ptr outer;
+
+        const chaiscript::Boxed_Value* find(const std::string & name) const {
+            for (auto e = this; e; e = e->outer.get()) {
+                // later bindings shadow earlier ones in the same scope
+                for (auto it = e->vars.rbegin(); it != e->vars.rend(); ++it) {
+                    if (it->first == name) {
+                        return &it->second;
+                    }
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    }
+
+chaiscript::Boxed_Value eval_token(token::Token token, chaiscript::ChaiScript* chai, const env::Ptr & env = nullptr) {
     switch (token.value.index()) {
         case token::value::BOOL:
             return chaiscript::Boxed_Value(std::get<bool>(token.value));
@@ -44,8 +201,19 @@ chaiscript::Boxed_Value eval_token(token::Token token, chaiscript::ChaiScript* c
         default: //case token::value::STRING:
             {
                 auto s = std::get<std::string>(token.value);
-                if (token.type == token::type::SYMBOL) {
-                    return chai->eval(s);
+                if (token.type == token::type::SYMBOL && s.size() > 1 && s[0] == ':') {
+                    return chaiscript::Boxed_Value(core::Keyword::intern(s));
+                } else if (token.type == token::type::SYMBOL) {
+                    if (env) {
+                        if (auto value = env->find(s)) {
+                            return *value;
+                        }
+                    }
+                    if (s.size() == 1 && OPERATORS.find(s[0]) != OPERATORS.end()) {
+                        // an operator passed as a value, as in (transduce xf + 0 coll)
+                        return chai->eval("`" + s + "`");
+                    }
+                    return chai->eval(munge(s));
                 } else {
                     return chaiscript::Boxed_Value(s);
                 }
@@ -53,16 +221,680 @@ chaiscript::Boxed_Value eval_token(token::Token token, chaiscript::ChaiScript* c
     }
 }
 
-form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai);
+    // zachlisp::profile
+    // opt-in sampling profiler that attributes the bytes allocated through ChaiScript's
+    // slab allocator (boxed values and script objects) to the list forms being evaluated
+    namespace profile {
+
+    struct Frame {
+        std::string name;
+        int line;
+        int column;
+    };
+
+    std::string to_string(const Frame & frame) {
+        return frame.name + "@" + std::to_string(frame.line) + ":" + std::to_string(frame.column);
+    }
+
+    struct Profile {
+        std::atomic<std::size_t> interval{0};
+        std::mutex mutex;
+        std::string folded_path;
+        // folded call stack -> sampled bytes, the input format of flamegraph.pl
+        std::map<std::string, std::size_t> stacks;
+        // innermost form -> sampled bytes
+        std::map<std::string, std::size_t> sites;
+    };
+
+    Profile & global() {
+        static Profile p;
+        return p;
+    }
+
+    std::vector<Frame> & stack() {
+        thread_local std::vector<Frame> frames;
+        return frames;
+    }
+
+    bool enabled() {
+        return global().interval.load(std::memory_order_relaxed) != 0;
+    }
+
+    std::size_t sample(std::size_t bytes) noexcept {
+        auto & p = global();
+        try {
+            std::string folded = "eval";
+            for (const auto & frame : stack()) {
+                folded += ";" + to_string(frame);
+            }
+            auto site = stack().empty() ? std::string("<top level>") : to_string(stack().back());
+            std::lock_guard<std::mutex> lock(p.mutex);
+            p.stacks[folded] += bytes;
+            p.sites[site] += bytes;
+        } catch (...) {}
+
+        // exponentially distributed gaps keep periodic allocation patterns from aliasing with the interval
+        thread_local std::minstd_rand rng(static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::exponential_distribution<double> gap(1.0 / std::max<std::size_t>(p.interval.load(std::memory_order_relaxed), 1));
+        return std::max<std::size_t>(static_cast<std::size_t>(gap(rng)), 1);
+    }
+
+    // samples roughly once every interval bytes, folded stacks go to folded_path when dumped
+    void start(std::size_t interval, std::string folded_path) {
+        auto & p = global();
+        {
+            std::lock_guard<std::mutex> lock(p.mutex);
+            p.folded_path = folded_path;
+        }
+        p.interval.store(interval, std::memory_order_relaxed);
+        chaiscript::detail::Allocation_Counter::set_sampler(interval == 0 ? nullptr : &sample);
+    }
+
+    // prints the sites sorted by sampled bytes and writes the folded stacks, if a path was given
+    void dump(std::ostream & out) {
+        auto & p = global();
+        std::lock_guard<std::mutex> lock(p.mutex);
+
+        std::vector<std::pair<std::string, std::size_t>> sites(p.sites.begin(), p.sites.end());
+        std::sort(sites.begin(), sites.end(), [](const auto & a, const auto & b) { return a.second > b.second; });
+        std::size_t total = 0;
+        for (const auto & site : sites) {
+            total += site.second;
+        }
+
+        out << "allocation profile: ~" << total << " bytes sampled every ~" << p.interval.load() << " bytes\n";
+        for (const auto & site : sites) {
+            out << std::setw(14) << site.second << std::setw(7) << std::fixed << std::setprecision(1)
+                << 100.0 * site.second / std::max<std::size_t>(total, 1) << "%  " << site.first << "\n";
+        }
+
+        if (!p.folded_path.empty()) {
+            std::ofstream folded(p.folded_path);
+            for (const auto & stack : p.stacks) {
+                folded << stack.first << " " << stack.second << "\n";
+            }
+        }
+    }
+
+    // marks a list form as being evaluated for as long as it lives
+    class Scope {
+    public:
+        Scope(const form::Form & head) {
+            if (enabled() && head.index() == form::TOKEN) {
+                auto token = std::get<token::Token>(head);
+                if (token.value.index() == token::value::STRING) {
+                    stack().push_back(Frame{std::get<std::string>(token.value), token.line, token.column});
+                    active = true;
+                }
+            }
+        }
+
+        ~Scope() {
+            if (active) {
+                stack().pop_back();
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+
+    private:
+        bool active = false;
+    };
+
+    }
+
+// with limits, only the part of bv that pr_str would print under the same limits is converted,
+// plus one item past the length limit so the printer can tell that more follow
+form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai, const Print_Limits & limits = {}, std::size_t level = 0);
+
+evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai, const env::Ptr & env = nullptr);
+
+evaled::Maybe eval_bench(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env);
+
+evaled::Maybe eval_set(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env);
+
+evaled::Maybe eval_let(const token::Token & head, std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env);
+
+evaled::Maybe eval_fn(const token::Token & head, std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env);
+
+evaled::Maybe eval_defrecord(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai);
+
+evaled::Maybe eval_keyword_call(const token::Token & keyword, const std::vector<chaiscript::Boxed_Value> & args);
+
+    // zachlisp::destructure
+    // binding patterns for let* and fn*, such as [a [b c] & more] or {:keys [d] e :e :or {e 0}}.
+    // a pattern is compiled once into a tree of prepared steps: vector patterns check the
+    // length once and index directly, map patterns look up keys that were converted ahead
+    // of time for each kind of map, so destructuring costs about as much as reading the
+    // slots by hand rather than a call to nth or get for every name
+    namespace destructure {
+
+    // a key of a map pattern, in the form each kind of map stores it
+    struct Key {
+        // std::map keys are the printed form of the key
+        std::string printed;
+        chaiscript::Boxed_Value boxed;
+        // set for keyword keys, which can name record fields
+        std::optional<core::Keyword> keyword;
+        std::shared_ptr<token::Site_Cache> cache = std::make_shared<token::Site_Cache>();
+        // the :or default of the name bound to this key
+        std::optional<form::Form> default_value;
+    };
+
+    struct Pattern {
+        enum Kind {SYMBOL, VECTOR, MAP};
+
+        Kind kind = SYMBOL;
+        std::string name;
+        // vector patterns: one pattern per position, and at most one for & rest
+        std::vector<Pattern> items;
+        std::vector<Pattern> rest;
+        // map patterns: the pattern in values[i] is bound to the value under keys[i]
+        std::vector<Key> keys;
+        std::vector<Pattern> values;
+        std::optional<std::string> as;
+    };
 
-evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
+    const std::string* symbol_name(const form::Form & form) {
+        if (form.index() != form::TOKEN) {
+            return nullptr;
+        }
+        const auto & token = std::get<token::Token>(form);
+        if (token.type != token::type::SYMBOL || token.value.index() != token::value::STRING) {
+            return nullptr;
+        }
+        return &std::get<std::string>(token.value);
+    }
+
+    form::Special invalid(const std::string & message, const form::Form & form) {
+        return form::Special{"RuntimeError", message + ": " + pr_str(form), std::nullopt};
+    }
+
+    std::optional<form::Special> compile_key(const form::Form & form, Key & key, chaiscript::ChaiScript* chai) {
+        const auto name = symbol_name(form);
+        if (form.index() != form::TOKEN || (name && (name->size() < 2 || (*name)[0] != ':'))) {
+            return invalid("Map pattern keys must be literals", form);
+        }
+        const auto & token = std::get<token::Token>(form);
+        key.printed = pr_str(token);
+        key.boxed = eval_token(token, chai);
+        if (name) {
+            key.keyword = core::Keyword::intern(*name);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<form::Special> compile(const form::Form & form, Pattern & pattern, chaiscript::ChaiScript* chai) {
+        if (auto name = symbol_name(form)) {
+            if (*name == "&" || (*name)[0] == ':') {
+                return invalid("Can't bind", form);
+            }
+            pattern.kind = Pattern::SYMBOL;
+            pattern.name = *name;
+            return std::nullopt;
+        }
+
+        if (form.index() == form::VECTOR) {
+            pattern.kind = Pattern::VECTOR;
+            const auto & items = std::get<std::vector<form::FormWrapper>>(form);
+            for (std::size_t i = 0; i < items.size(); i++) {
+                const auto name = symbol_name(items[i].form);
+                if (name && (*name == "&" || *name == ":as")) {
+                    if (i + 1 == items.size() || (*name == "&" && !pattern.rest.empty()) || (*name == ":as" && pattern.as)) {
+                        return invalid("Invalid vector pattern", form);
+                    }
+                    Pattern sub;
+                    if (auto err = compile(items[++i].form, sub, chai)) {
+                        return err;
+                    }
+                    if (*name == "&") {
+                        pattern.rest.push_back(std::move(sub));
+                    } else if (sub.kind == Pattern::SYMBOL) {
+                        pattern.as = sub.name;
+                    } else {
+                        return invalid(":as takes a symbol", form);
+                    }
+                } else if (!pattern.rest.empty() || pattern.as) {
+                    return invalid("Invalid vector pattern", form);
+                } else {
+                    pattern.items.emplace_back();
+                    if (auto err = compile(items[i].form, pattern.items.back(), chai)) {
+                        return err;
+                    }
+                }
+            }
+            return std::nullopt;
+        }
+
+        if (form.index() == form::MAP) {
+            pattern.kind = Pattern::MAP;
+            const form::FormWrapperMap* defaults = nullptr;
+            for (const auto & entry : *std::get<std::shared_ptr<form::FormWrapperMap>>(form)) {
+                const auto name = symbol_name(entry.first.form);
+                if (name && (*name == ":keys" || *name == ":strs")) {
+                    if (entry.second.form.index() != form::VECTOR) {
+                        return invalid(*name + " takes a vector of symbols", form);
+                    }
+                    for (const auto & item : std::get<std::vector<form::FormWrapper>>(entry.second.form)) {
+                        pattern.values.emplace_back();
+                        if (auto err = compile(item.form, pattern.values.back(), chai)) {
+                            return err;
+                        }
+                        if (pattern.values.back().kind != Pattern::SYMBOL) {
+                            return invalid(*name + " takes a vector of symbols", form);
+                        }
+                        const auto & field = pattern.values.back().name;
+                        pattern.keys.emplace_back();
+                        const form::Form key = *name == ":keys"
+                            ? token::Token{":" + field, token::type::SYMBOL, 0, 0}
+                            : token::Token{field, token::type::STRING, 0, 0};
+                        compile_key(key, pattern.keys.back(), chai);
+                    }
+                } else if (name && *name == ":as") {
+                    const auto as = symbol_name(entry.second.form);
+                    if (!as) {
+                        return invalid(":as takes a symbol", form);
+                    }
+                    pattern.as = *as;
+                } else if (name && *name == ":or") {
+                    if (entry.second.form.index() != form::MAP) {
+                        return invalid(":or takes a map", form);
+                    }
+                    defaults = std::get<std::shared_ptr<form::FormWrapperMap>>(entry.second.form).get();
+                } else {
+                    pattern.values.emplace_back();
+                    pattern.keys.emplace_back();
+                    if (auto err = compile(entry.first.form, pattern.values.back(), chai)) {
+                        return err;
+                    }
+                    if (auto err = compile_key(entry.second.form, pattern.keys.back(), chai)) {
+                        return err;
+                    }
+                }
+            }
+
+            if (defaults) {
+                for (const auto & entry : *defaults) {
+                    const auto name = symbol_name(entry.first.form);
+                    std::size_t i = 0;
+                    while (i < pattern.values.size() && !(name && pattern.values[i].kind == Pattern::SYMBOL && pattern.values[i].name == *name)) {
+                        i++;
+                    }
+                    if (i == pattern.values.size()) {
+                        return invalid(":or names a symbol that isn't bound", entry.first.form);
+                    }
+                    pattern.keys[i].default_value = entry.second.form;
+                }
+            }
+            return std::nullopt;
+        }
+
+        return invalid("Can't destructure with", form);
+    }
+
+    std::optional<form::Special> bind(const Pattern & pattern, const chaiscript::Boxed_Value & value, const std::shared_ptr<env::Env> & frame, chaiscript::ChaiScript* chai);
+
+    // binds a vector pattern's positions and rest to the values in [begin, end), which are
+    // all of owner's items, or a call's arguments when owner is nil; positions past the end
+    // are bound to nil. the rest is a view of the same values, and is also stored in rest
+    // when that is given
+    std::optional<form::Special> bind_items(const Pattern & pattern, const chaiscript::Boxed_Value & owner,
+                                            const chaiscript::Boxed_Value* begin, const chaiscript::Boxed_Value* end,
+                                            const std::shared_ptr<env::Env> & frame, chaiscript::ChaiScript* chai,
+                                            std::shared_ptr<core::Rest_Args>* rest = nullptr) {
+        const std::size_t size = end - begin;
+        for (std::size_t i = 0; i < pattern.items.size(); i++) {
+            if (auto err = destructure::bind(pattern.items[i], i < size ? begin[i] : chaiscript::Boxed_Value(), frame, chai)) {
+                return err;
+            }
+        }
+        if (!pattern.rest.empty()) {
+            auto view = std::make_shared<core::Rest_Args>();
+            view->owner = owner;
+            view->begin = std::min(size, pattern.items.size());
+            view->end = size;
+            if (owner.is_null()) {
+                view->args = begin;
+            }
+            if (rest) {
+                *rest = view;
+            }
+            return destructure::bind(pattern.rest.front(), chaiscript::Boxed_Value(view), frame, chai);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<form::Special> bind_keys(const Pattern & pattern, const chaiscript::Boxed_Value & value,
+                                           const std::shared_ptr<env::Env> & frame, chaiscript::ChaiScript* chai) {
+        // the kind of map is checked once, each key is then a single lookup
+        std::function<const chaiscript::Boxed_Value*(const Key &)> lookup;
+        const auto & type = value.get_type_info();
+        if (value.is_null()) {
+            lookup = [](const Key &) -> const chaiscript::Boxed_Value* { return nullptr; };
+        } else if (type.bare_equal(chaiscript::user_type<core::Record>())) {
+            const auto & record = chaiscript::boxed_cast<const core::Record &>(value);
+            lookup = [&record](const Key & key) -> const chaiscript::Boxed_Value* {
+                if (!key.keyword) {
+                    return nullptr;
+                }
+                metrics::site_cache(record.guessed(*key.keyword, key.cache->slot.load(std::memory_order_relaxed)));
+                return record.find(*key.keyword, key.cache->slot);
+            };
+        } else if (type.bare_equal(chaiscript::user_type<std::map<std::string, chaiscript::Boxed_Value>>())) {
+            const auto & map = chaiscript::boxed_cast<const std::map<std::string, chaiscript::Boxed_Value> &>(value);
+            lookup = [&map](const Key & key) -> const chaiscript::Boxed_Value* {
+                const auto it = map.find(key.printed);
+                return it != map.end() ? &it->second : nullptr;
+            };
+        } else if (type.bare_equal(chaiscript::user_type<core::Sorted_Map>())) {
+            const auto & map = chaiscript::boxed_cast<const core::Sorted_Map &>(value);
+            lookup = [&map](const Key & key) { return map.find(key.boxed); };
+        } else {
+            return form::Special{"RuntimeError", "Map patterns need a map or a record", std::nullopt};
+        }
+
+        for (std::size_t i = 0; i < pattern.keys.size(); i++) {
+            const auto & key = pattern.keys[i];
+            chaiscript::Boxed_Value found;
+            if (auto v = lookup(key)) {
+                found = *v;
+            } else if (key.default_value) {
+                auto ret = form_to_chai(*key.default_value, chai, frame);
+                if (ret.index() == evaled::SPECIAL) {
+                    return std::get<form::Special>(ret);
+                }
+                found = std::get<chaiscript::Boxed_Value>(ret);
+            }
+            if (auto err = destructure::bind(pattern.values[i], found, frame, chai)) {
+                return err;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // binds the names in pattern to the parts of value, adding them to frame
+    std::optional<form::Special> bind(const Pattern & pattern, const chaiscript::Boxed_Value & value, const std::shared_ptr<env::Env> & frame, chaiscript::ChaiScript* chai) {
+        switch (pattern.kind) {
+            case Pattern::SYMBOL:
+                frame->vars.emplace_back(pattern.name, value);
+                return std::nullopt;
+            case Pattern::VECTOR:
+                {
+                    const chaiscript::Boxed_Value* first;
+                    const chaiscript::Boxed_Value* last;
+                    if (!core::items(value, first, last)) {
+                        return form::Special{"RuntimeError", "Vector patterns need a vector or a list", std::nullopt};
+                    }
+                    if (auto err = bind_items(pattern, value, first, last, frame, chai)) {
+                        return err;
+                    }
+                    break;
+                }
+            case Pattern::MAP:
+                if (auto err = bind_keys(pattern, value, frame, chai)) {
+                    return err;
+                }
+                break;
+        }
+        if (pattern.as) {
+            frame->vars.emplace_back(*pattern.as, value);
+        }
+        return std::nullopt;
+    }
+
+    using Plan = std::vector<Pattern>;
+
+    // compiles the patterns of a let* or fn* form, or reuses the ones compiled
+    // the last time it was evaluated, which its head symbol's cache holds
+    std::optional<form::Special> plan(const token::Token & head, const std::vector<form::Form> & patterns, chaiscript::ChaiScript* chai,
+                                      std::shared_ptr<const Plan> & ret) {
+        if (head.cache) {
+            auto compiled = std::atomic_load(&head.cache->compiled);
+            metrics::site_cache(compiled != nullptr);
+            if (compiled) {
+                ret = std::static_pointer_cast<const Plan>(compiled);
+                return std::nullopt;
+            }
+        }
+        auto compiled = std::make_shared<Plan>(patterns.size());
+        for (std::size_t i = 0; i < patterns.size(); i++) {
+            if (auto err = compile(patterns[i], (*compiled)[i], chai)) {
+                return err;
+            }
+        }
+        if (head.cache) {
+            std::atomic_store(&head.cache->compiled, std::shared_ptr<const void>(compiled));
+        }
+        ret = compiled;
+        return std::nullopt;
+    }
+
+    }
+
+    // zachlisp::quasi
+    // quote and quasiquote templates, analysed once per site. parts without unquotes are
+    // built once and copied for each evaluation; around the unquotes the template becomes
+    // a tree of constructors that evaluate their parts, then size the result before filling it
+    namespace quasi {
+
+    struct Template {
+        enum Kind {CONSTANT, UNQUOTE, SPLICE, LIST, VECTOR, MAP, SET};
+
+        Kind kind = CONSTANT;
+        chaiscript::Boxed_Value constant;
+        // the form to evaluate for UNQUOTE and SPLICE
+        std::optional<form::Form> form;
+        // the parts of a collection; keys and values alternate in a map
+        std::vector<Template> items;
+    };
+
+    // the form after name in (name form), if that's what list is
+    const form::Form* unquoted(const std::list<form::FormWrapper> & list, const std::string & name) {
+        if (list.size() != 2) {
+            return nullptr;
+        }
+        const auto head = destructure::symbol_name(list.front().form);
+        return head && *head == name ? &list.back().form : nullptr;
+    }
+
+    std::string map_key(const chaiscript::Boxed_Value & key, chaiscript::ChaiScript* chai) {
+        return pr_str(chai_to_form(key, chai));
+    }
+
+    std::optional<form::Special> compile(const form::Form & form, bool quasi, Template & t, chaiscript::ChaiScript* chai);
+
+    // compiles the items of a collection, and builds it right away if they are all constant
+    std::optional<form::Special> compile_items(const std::vector<const form::Form*> & items, bool quasi, Template::Kind kind, Template & t, chaiscript::ChaiScript* chai) {
+        t.kind = kind;
+        t.items.resize(items.size());
+        bool constant = true;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            const form::Form* splice = nullptr;
+            if (quasi && items[i]->index() == form::LIST) {
+                splice = unquoted(std::get<std::list<form::FormWrapper>>(*items[i]), "splice-unquote");
+            }
+            if (splice) {
+                t.items[i].kind = Template::SPLICE;
+                t.items[i].form = *splice;
+            } else if (auto err = compile(*items[i], quasi, t.items[i], chai)) {
+                return err;
+            }
+            constant = constant && t.items[i].kind == Template::CONSTANT;
+        }
+        if (!constant) {
+            return std::nullopt;
+        }
+
+        std::vector<chaiscript::Boxed_Value> values;
+        values.reserve(t.items.size());
+        for (const auto & item : t.items) {
+            values.push_back(item.constant);
+        }
+        t.items.clear();
+        t.kind = Template::CONSTANT;
+        switch (kind) {
+            case Template::LIST:
+                t.constant = chaiscript::Boxed_Value(core::List{std::move(values)});
+                break;
+            case Template::VECTOR:
+                t.constant = chaiscript::Boxed_Value(std::move(values));
+                break;
+            default:
+                {
+                    std::map<std::string, chaiscript::Boxed_Value> map;
+                    const std::size_t step = kind == Template::MAP ? 2 : 1;
+                    for (std::size_t i = 0; i < values.size(); i += step) {
+                        map.emplace(map_key(values[i], chai), values[i + step - 1]);
+                    }
+                    t.constant = kind == Template::MAP ? chaiscript::Boxed_Value(std::move(map))
+                                                       : chaiscript::Boxed_Value(core::Hash_Set{std::move(map)});
+                }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<form::Special> compile(const form::Form & form, bool quasi, Template & t, chaiscript::ChaiScript* chai) {
+        switch (form.index()) {
+            case form::TOKEN:
+                {
+                    const auto & token = std::get<token::Token>(form);
+                    const auto name = destructure::symbol_name(form);
+                    if (name && *name == "nil") {
+                        t.constant = chaiscript::Boxed_Value();
+                    } else if (name && !(name->size() > 1 && (*name)[0] == ':')) {
+                        t.constant = chaiscript::Boxed_Value(core::Symbol::intern(*name));
+                    } else {
+                        t.constant = eval_token(token, chai);
+                    }
+                    return std::nullopt;
+                }
+            case form::LIST:
+                {
+                    const auto & list = std::get<std::list<form::FormWrapper>>(form);
+                    if (quasi) {
+                        if (auto unquote = unquoted(list, "unquote")) {
+                            t.kind = Template::UNQUOTE;
+                            t.form = *unquote;
+                            return std::nullopt;
+                        }
+                    }
+                    std::vector<const form::Form*> items;
+                    for (const auto & item : list) {
+                        items.push_back(&item.form);
+                    }
+                    return compile_items(items, quasi, Template::LIST, t, chai);
+                }
+            case form::VECTOR:
+                {
+                    std::vector<const form::Form*> items;
+                    for (const auto & item : std::get<std::vector<form::FormWrapper>>(form)) {
+                        items.push_back(&item.form);
+                    }
+                    return compile_items(items, quasi, Template::VECTOR, t, chai);
+                }
+            case form::MAP:
+                {
+                    std::vector<const form::Form*> items;
+                    for (const auto & entry : *std::get<std::shared_ptr<form::FormWrapperMap>>(form)) {
+                        items.push_back(&entry.first.form);
+                        items.push_back(&entry.second.form);
+                    }
+                    return compile_items(items, quasi, Template::MAP, t, chai);
+                }
+            case form::SET:
+                {
+                    std::vector<const form::Form*> items;
+                    for (const auto & item : *std::get<std::shared_ptr<form::FormWrapperSet>>(form)) {
+                        items.push_back(&item.form);
+                    }
+                    return compile_items(items, quasi, Template::SET, t, chai);
+                }
+        }
+        return std::get<form::Special>(form);
+    }
+
+    evaled::Maybe build(const Template & t, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+        switch (t.kind) {
+            case Template::CONSTANT:
+                return core::copy(t.constant);
+            case Template::UNQUOTE:
+            case Template::SPLICE:
+                return form_to_chai(*t.form, chai, env);
+            default:
+                break;
+        }
+
+        // evaluate the parts first so the result can be allocated at its final size
+        std::vector<chaiscript::Boxed_Value> parts;
+        parts.reserve(t.items.size());
+        std::size_t size = 0;
+        for (const auto & item : t.items) {
+            auto part = build(item, chai, env);
+            if (part.index() == evaled::SPECIAL) {
+                return part;
+            }
+            parts.push_back(std::get<chaiscript::Boxed_Value>(part));
+            if (item.kind == Template::SPLICE) {
+                const chaiscript::Boxed_Value* first;
+                const chaiscript::Boxed_Value* last;
+                if (!core::items(parts.back(), first, last)) {
+                    return form::Special{"RuntimeError", "splice-unquote needs a list or a vector", std::nullopt};
+                }
+                size += last - first;
+            } else {
+                size++;
+            }
+        }
+
+        std::vector<chaiscript::Boxed_Value> values;
+        values.reserve(size);
+        for (std::size_t i = 0; i < parts.size(); i++) {
+            if (t.items[i].kind == Template::SPLICE) {
+                const chaiscript::Boxed_Value* first;
+                const chaiscript::Boxed_Value* last;
+                core::items(parts[i], first, last);
+                values.insert(values.end(), first, last);
+            } else {
+                values.push_back(std::move(parts[i]));
+            }
+        }
+
+        switch (t.kind) {
+            case Template::LIST:
+                return chaiscript::Boxed_Value(core::List{std::move(values)});
+            case Template::VECTOR:
+                return chaiscript::Boxed_Value(std::move(values));
+            default:
+                {
+                    const std::size_t step = t.kind == Template::MAP ? 2 : 1;
+                    if (values.size() % step != 0) {
+                        return form::Special{"RuntimeError", "Map must contain even number of forms", std::nullopt};
+                    }
+                    std::map<std::string, chaiscript::Boxed_Value> map;
+                    for (std::size_t i = 0; i < values.size(); i += step) {
+                        map.emplace(map_key(values[i], chai), values[i + step - 1]);
+                    }
+                    if (t.kind == Template::MAP) {
+                        return chaiscript::Boxed_Value(std::move(map));
+                    }
+                    return chaiscript::Boxed_Value(core::Hash_Set{std::move(map)});
+                }
+        }
+    }
+
+    }
+
+evaled::Maybe eval_quote(const token::Token & head, std::list<form::FormWrapper> args, bool quasi, chaiscript::ChaiScript* chai, const env::Ptr & env);
+
+evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai, const env::Ptr & env) {
     switch (form.index()) {
         case form::SPECIAL:
             return std::get<form::Special>(form);
         case form::TOKEN:
             {
                 auto token = std::get<token::Token>(form);
-                return eval_token(token, chai);
+                return eval_token(token, chai, env);
             }
         case form::LIST:
             {
@@ -73,9 +905,37 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                     auto first_form = list.front().form;
                     list.pop_front();
 
+                    std::string fn_name = "";
+                    if (first_form.index() == form::TOKEN) {
+                        auto token = std::get<token::Token>(first_form);
+                        if (token.type == token::type::SYMBOL) {
+                            fn_name = std::get<std::string>(token.value);
+                        }
+                    }
+
+                    const profile::Scope profile_scope(first_form);
+
+                    // special forms receive their arguments unevaluated
+                    if (fn_name == "quote" || fn_name == "quasiquote") {
+                        return eval_quote(std::get<token::Token>(first_form), list, fn_name == "quasiquote", chai, env);
+                    } else if (fn_name == "let*") {
+                        return eval_let(std::get<token::Token>(first_form), list, chai, env);
+                    } else if (fn_name == "fn*") {
+                        return eval_fn(std::get<token::Token>(first_form), list, chai, env);
+                    } else if (fn_name == "bench") {
+                        return eval_bench(list, chai, env);
+                    } else if (fn_name == "defrecord") {
+                        return eval_defrecord(list, chai);
+                    } else if (fn_name == "set!") {
+                        return eval_set(list, chai, env);
+                    } else if (fn_name == "alloc-profile") {
+                        profile::dump(std::cerr);
+                        return chaiscript::Boxed_Value();
+                    }
+
                     std::vector<chaiscript::Boxed_Value> args;
                     for (auto it = list.begin(); it != list.end(); ++it) {
-                        auto ret = form_to_chai((*it).form, chai);
+                        auto ret = form_to_chai((*it).form, chai, env);
                         switch (ret.index()) {
                             case evaled::SPECIAL:
                                 return ret;
@@ -87,15 +947,9 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                         }
                     }
 
-                    std::string fn_name = "";
-                    if (first_form.index() == form::TOKEN) {
-                        auto token = std::get<token::Token>(first_form);
-                        if (token.type == token::type::SYMBOL) {
-                            fn_name = std::get<std::string>(token.value);
-                        }
-                    }
-
-                    if (fn_name.size() == 1 && OPERATORS.find(fn_name.at(0)) != OPERATORS.end()) {
+                    if (fn_name.size() > 1 && fn_name[0] == ':') {
+                        return eval_keyword_call(std::get<token::Token>(first_form), args);
+                    } else if (fn_name.size() == 1 && OPERATORS.find(fn_name.at(0)) != OPERATORS.end()) {
                         if (args.size() >= 2) {
                             auto fn = chai->eval<evaled::fn::Two>("`" + fn_name + "`");
                             auto ret = fn(args[0], args[1]);
@@ -105,52 +959,13 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                             return ret;
                         }
                     } else {
-                        auto ret = form_to_chai(first_form, chai);
+                        auto ret = form_to_chai(first_form, chai, env);
                         switch (ret.index()) {
                             case evaled::SPECIAL:
                                 return ret;
                             case evaled::CHAI:
-                                {
-                                    auto chai_fn = std::get<chaiscript::Boxed_Value>(ret);
-
-                                    switch (args.size()) {
-                                        case evaled::fn::ZERO:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Zero>(chai_fn);
-                                                return fn();
-                                            }
-                                        case evaled::fn::ONE:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::One>(chai_fn);
-                                                return fn(args[0]);
-                                            }
-                                        case evaled::fn::TWO:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Two>(chai_fn);
-                                                return fn(args[0], args[1]);
-                                            }
-                                        case evaled::fn::THREE:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Three>(chai_fn);
-                                                return fn(args[0], args[1], args[2]);
-                                            }
-                                        case evaled::fn::FOUR:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Four>(chai_fn);
-                                                return fn(args[0], args[1], args[2], args[3]);
-                                            }
-                                        case evaled::fn::FIVE:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Five>(chai_fn);
-                                                return fn(args[0], args[1], args[2], args[3], args[4]);
-                                            }
-                                        case evaled::fn::SIX:
-                                            {
-                                                auto fn = chai->boxed_cast<evaled::fn::Six>(chai_fn);
-                                                return fn(args[0], args[1], args[2], args[3], args[4], args[5]);
-                                            }
-                                    }
-                                }
+                                // the arguments are passed in place, however many there are
+                                return core::call(*chai, std::get<chaiscript::Boxed_Value>(ret), args);
                         }
                     }
 
@@ -163,7 +978,7 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                 auto new_vec = std::vector<chaiscript::Boxed_Value>();
 
                 for (auto it = vec.begin(); it != vec.end(); ++it) {
-                    auto ret = form_to_chai((*it).form, chai);
+                    auto ret = form_to_chai((*it).form, chai, env);
                     switch (ret.index()) {
                         case evaled::SPECIAL:
                             return ret;
@@ -184,12 +999,12 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                 auto new_map_it = new_map.begin();
 
                 for (auto it = map.begin(); it != map.end(); ++it) {
-                    auto key = form_to_chai((*it).first.form, chai);
+                    auto key = form_to_chai((*it).first.form, chai, env);
                     switch (key.index()) {
                         case evaled::SPECIAL:
                             return key;
                     }
-                    auto val = form_to_chai((*it).second.form, chai);
+                    auto val = form_to_chai((*it).second.form, chai, env);
                     switch (val.index()) {
                         case evaled::SPECIAL:
                             return key;
@@ -209,7 +1024,7 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                 auto new_set_it = new_set.begin();
 
                 for (auto it = set.begin(); it != set.end(); ++it) {
-                    auto key = form_to_chai((*it).form, chai);
+                    auto key = form_to_chai((*it).form, chai, env);
                     switch (key.index()) {
                         case evaled::SPECIAL:
                             return key;
@@ -219,54 +1034,416 @@ evaled::Maybe form_to_chai(form::Form form, chaiscript::ChaiScript* chai) {
                     new_set.insert(new_set_it, std::pair(stringified_key, new_key));
                 }
 
-                return chaiscript::Boxed_Value(new_set);
+                return chaiscript::Boxed_Value(core::Hash_Set{std::move(new_set)});
             }
     }
     return form::Special{"RuntimeError", "Form not recognized", std::nullopt};
 }
 
-form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai) {
+// (quote form) or (quasiquote form)
+// form as data. the template is compiled the first time the site is evaluated
+// and kept in its head symbol's cache
+evaled::Maybe eval_quote(const token::Token & head, std::list<form::FormWrapper> args, bool quasi, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+    if (args.size() != 1) {
+        return form::Special{"RuntimeError", std::get<std::string>(head.value) + " takes one form", std::nullopt};
+    }
+
+    std::shared_ptr<const quasi::Template> t;
+    if (head.cache) {
+        t = std::static_pointer_cast<const quasi::Template>(std::atomic_load(&head.cache->compiled));
+        metrics::site_cache(t != nullptr);
+    }
+    if (!t) {
+        auto compiled = std::make_shared<quasi::Template>();
+        if (auto err = quasi::compile(args.front().form, quasi, *compiled, chai)) {
+            return *err;
+        }
+        if (head.cache) {
+            std::atomic_store(&head.cache->compiled, std::shared_ptr<const void>(compiled));
+        }
+        t = compiled;
+    }
+    return quasi::build(*t, chai, env);
+}
+
+// (let* [pattern value ...] body...)
+// binds each pattern in turn, so a value can use the names bound before it, then
+// evaluates the body in that scope
+evaled::Maybe eval_let(const token::Token & head, std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+    if (args.empty() || (args.front().form.index() != form::VECTOR && args.front().form.index() != form::LIST)) {
+        return form::Special{"RuntimeError", "let* takes a vector of bindings and a body", std::nullopt};
+    }
+
+    std::vector<form::Form> patterns;
+    std::vector<form::Form> values;
+    auto add = [&](const form::FormWrapper & fw) {
+        (patterns.size() == values.size() ? patterns : values).push_back(fw.form);
+    };
+    if (args.front().form.index() == form::VECTOR) {
+        std::for_each(std::get<std::vector<form::FormWrapper>>(args.front().form).begin(), std::get<std::vector<form::FormWrapper>>(args.front().form).end(), add);
+    } else {
+        std::for_each(std::get<std::list<form::FormWrapper>>(args.front().form).begin(), std::get<std::list<form::FormWrapper>>(args.front().form).end(), add);
+    }
+    if (patterns.size() != values.size()) {
+        return form::Special{"RuntimeError", "let* needs a value for every pattern", std::nullopt};
+    }
+    args.pop_front();
+
+    std::shared_ptr<const destructure::Plan> plan;
+    if (auto err = destructure::plan(head, patterns, chai, plan)) {
+        return *err;
+    }
+
+    auto frame = std::make_shared<env::Env>();
+    frame->outer = env;
+    frame->vars.reserve(patterns.size());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        auto value = form_to_chai(values[i], chai, frame);
+        if (value.index() == evaled::SPECIAL) {
+            return value;
+        }
+        if (auto err = destructure::bind((*plan)[i], std::get<chaiscript::Boxed_Value>(value), frame, chai)) {
+            return *err;
+        }
+    }
+
+    evaled::Maybe ret = chaiscript::Boxed_Value();
+    for (const auto & body : args) {
+        ret = form_to_chai(body.form, chai, frame);
+        if (ret.index() == evaled::SPECIAL) {
+            return ret;
+        }
+    }
+    return ret;
+}
+
+// (fn* [params] body...)
+// makes a function that closes over the current scope. params is a vector pattern, so
+// the arguments are destructured straight from the call's argument array
+evaled::Maybe eval_fn(const token::Token & head, std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+    if (args.empty() || (args.front().form.index() != form::VECTOR && args.front().form.index() != form::LIST)) {
+        return form::Special{"RuntimeError", "fn* takes a vector of parameters and a body", std::nullopt};
+    }
+
+    auto params = args.front().form;
+    if (params.index() == form::LIST) {
+        params = list_to_vector(std::get<std::list<form::FormWrapper>>(params));
+    }
+    args.pop_front();
+
+    std::shared_ptr<const destructure::Plan> plan;
+    if (auto err = destructure::plan(head, {params}, chai, plan)) {
+        return *err;
+    }
+
+    auto body = std::make_shared<const std::list<form::FormWrapper>>(std::move(args));
+    return chaiscript::Boxed_Value(chaiscript::Proxy_Function(chaiscript::dispatch::make_dynamic_proxy_function(
+        [chai, env, plan, body](const chaiscript::Function_Params & params) {
+            // the rest arguments view the caller's argument array. if they are still
+            // referenced once the call is over, by the result, a closure or a view of
+            // them, they are copied
+            struct Rest_Guard {
+                std::shared_ptr<core::Rest_Args> rest;
+                std::shared_ptr<env::Env> frame;
+
+                ~Rest_Guard() {
+                    frame.reset();
+                    if (rest && rest.use_count() > 1) {
+                        rest->materialise();
+                    }
+                }
+            } guard;
+
+            const auto & pattern = plan->front();
+            auto & frame = guard.frame = std::make_shared<env::Env>();
+            frame->outer = env;
+            if (auto err = destructure::bind_items(pattern, chaiscript::Boxed_Value(), params.begin(), params.end(), frame, chai, &guard.rest)) {
+                throw evaled::Error(*err);
+            }
+            if (pattern.as) {
+                frame->vars.emplace_back(*pattern.as, chaiscript::Boxed_Value(params.to_vector()));
+            }
+
+            chaiscript::Boxed_Value ret;
+            for (const auto & form : *body) {
+                auto value = form_to_chai(form.form, chai, frame);
+                if (value.index() == evaled::SPECIAL) {
+                    throw evaled::Error(std::get<form::Special>(value));
+                }
+                ret = std::get<chaiscript::Boxed_Value>(value);
+            }
+            return ret;
+        })));
+}
+
+// (bench expr) or (bench expr samples)
+// evaluates expr repeatedly and returns its timing and allocation statistics as a map
+evaled::Maybe eval_bench(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+    if (args.size() < 1 || args.size() > 2) {
+        return form::Special{"RuntimeError", "bench takes an expression and an optional sample count", std::nullopt};
+    }
+
+    auto expr = args.front().form;
+    bench::Options options;
+    if (args.size() == 2) {
+        auto samples = form_to_chai(args.back().form, chai, env);
+        if (samples.index() == evaled::SPECIAL) {
+            return samples;
+        }
+        auto n = chaiscript::Boxed_Number(std::get<chaiscript::Boxed_Value>(samples)).get_as<long>();
+        if (n < 2) {
+            return form::Special{"RuntimeError", "bench needs at least 2 samples", std::nullopt};
+        }
+        options.samples = n;
+    }
+
+    // report errors before timing them
+    auto first = form_to_chai(expr, chai, env);
+    if (first.index() == evaled::SPECIAL) {
+        return first;
+    }
+
+    auto result = bench::run([&]() { form_to_chai(expr, chai, env); }, options);
+
+    // keyword keys, like memo-stats
+    auto key = [](std::string name) {
+        return pr_str(token::Token{":" + name, token::type::SYMBOL, 0, 0});
+    };
+    return chaiscript::Boxed_Value(std::map<std::string, chaiscript::Boxed_Value>{
+        {key("samples"), chaiscript::Boxed_Value(static_cast<long>(result.samples))},
+        {key("iterations"), chaiscript::Boxed_Value(static_cast<long>(result.iterations))},
+        {key("mean-ns"), chaiscript::Boxed_Value(result.mean)},
+        {key("stddev-ns"), chaiscript::Boxed_Value(result.stddev)},
+        {key("min-ns"), chaiscript::Boxed_Value(result.min)},
+        {key("p50-ns"), chaiscript::Boxed_Value(result.p50)},
+        {key("p90-ns"), chaiscript::Boxed_Value(result.p90)},
+        {key("p99-ns"), chaiscript::Boxed_Value(result.p99)},
+        {key("max-ns"), chaiscript::Boxed_Value(result.max)},
+        {key("allocations"), chaiscript::Boxed_Value(result.allocations)},
+        {key("bytes"), chaiscript::Boxed_Value(result.bytes)}
+    });
+}
+
+// (defrecord Name [field1 field2 ...])
+// defines a record type and binds Name to its constructor, which takes one argument per field
+evaled::Maybe eval_defrecord(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai) {
+    auto is_symbol = [](const form::Form & form) {
+        return form.index() == form::TOKEN && std::get<token::Token>(form).type == token::type::SYMBOL
+            && std::get<token::Token>(form).value.index() == token::value::STRING;
+    };
+
+    if (args.size() != 2 || !is_symbol(args.front().form) || args.back().form.index() != form::VECTOR) {
+        return form::Special{"RuntimeError", "defrecord takes a name and a vector of fields", std::nullopt};
+    }
+
+    auto type = std::make_shared<core::Record_Type>();
+    type->name = std::get<std::string>(std::get<token::Token>(args.front().form).value);
+    for (const auto & field : std::get<std::vector<form::FormWrapper>>(args.back().form)) {
+        if (!is_symbol(field.form)) {
+            return form::Special{"RuntimeError", "Record fields must be symbols", std::nullopt};
+        }
+        const auto name = std::get<std::string>(std::get<token::Token>(field.form).value);
+        const auto keyword = core::Keyword::intern(":" + name);
+        if (std::find(type->fields.begin(), type->fields.end(), keyword) != type->fields.end()) {
+            return form::Special{"RuntimeError", "Duplicate field " + name + " in record " + type->name, std::nullopt};
+        }
+        type->fields.push_back(keyword);
+    }
+
+    chai->set_global(chaiscript::Boxed_Value(core::record_constructor(type)), munge(type->name));
+    return chaiscript::Boxed_Value();
+}
+
+// (:key coll) or (:key coll not-found)
+// looks the keyword up in a record, map or sorted map. record lookups go through the
+// call site's cache of the field's slot, so repeated access is one comparison
+evaled::Maybe eval_keyword_call(const token::Token & keyword, const std::vector<chaiscript::Boxed_Value> & args) {
+    if (args.size() < 1 || args.size() > 2) {
+        return form::Special{"RuntimeError", "Invalid number of arguments keyword " + std::get<std::string>(keyword.value), std::nullopt};
+    }
+
+    const auto & name = std::get<std::string>(keyword.value);
+    const auto & coll = args[0];
+    const auto not_found = args.size() == 2 ? args[1] : chaiscript::Boxed_Value();
+    const auto & type = coll.get_type_info();
+
+    if (type.bare_equal(chaiscript::user_type<core::Record>())) {
+        const auto & record = chaiscript::boxed_cast<const core::Record &>(coll);
+        const auto k = core::Keyword::intern(name);
+        if (!keyword.cache) {
+            const auto value = record.find(k);
+            return value ? *value : not_found;
+        }
+        metrics::site_cache(record.guessed(k, keyword.cache->slot.load(std::memory_order_relaxed)));
+        const auto value = record.find(k, keyword.cache->slot);
+        return value ? *value : not_found;
+    } else if (type.bare_equal(chaiscript::user_type<std::map<std::string, chaiscript::Boxed_Value>>())) {
+        const auto & map = chaiscript::boxed_cast<const std::map<std::string, chaiscript::Boxed_Value> &>(coll);
+        const auto it = map.find(name);
+        return it != map.end() ? it->second : not_found;
+    } else if (type.bare_equal(chaiscript::user_type<core::Hash_Set>())) {
+        const auto & items = chaiscript::boxed_cast<const core::Hash_Set &>(coll).items;
+        const auto it = items.find(name);
+        return it != items.end() ? it->second : not_found;
+    } else if (type.bare_equal(chaiscript::user_type<core::Sorted_Map>())) {
+        const auto value = chaiscript::boxed_cast<const core::Sorted_Map &>(coll).find(chaiscript::Boxed_Value(core::Keyword::intern(name)));
+        return value ? *value : not_found;
+    }
+    return not_found;
+}
+
+// (set! *print-length* n) or (set! *print-level* n)
+// sets a printing limit, or removes it when n is nil
+evaled::Maybe eval_set(std::list<form::FormWrapper> args, chaiscript::ChaiScript* chai, const env::Ptr & env) {
+    if (args.size() != 2) {
+        return form::Special{"RuntimeError", "set! takes a var and a value", std::nullopt};
+    }
+
+    auto is_symbol = [](const form::Form & form, const std::string & name) {
+        if (form.index() != form::TOKEN) {
+            return false;
+        }
+        auto token = std::get<token::Token>(form);
+        return token.type == token::type::SYMBOL && token.value == token::value::Value(name);
+    };
+
+    std::optional<std::size_t>* limit = nullptr;
+    if (is_symbol(args.front().form, "*print-length*")) {
+        limit = &print_limits().length;
+    } else if (is_symbol(args.front().form, "*print-level*")) {
+        limit = &print_limits().level;
+    } else {
+        return form::Special{"RuntimeError", "Can't set " + pr_str(args.front().form), std::nullopt};
+    }
+
+    if (is_symbol(args.back().form, "nil")) {
+        limit->reset();
+        return chaiscript::Boxed_Value();
+    }
+
+    auto value = form_to_chai(args.back().form, chai, env);
+    if (value.index() == evaled::SPECIAL) {
+        return value;
+    }
+    auto n = chaiscript::Boxed_Number(std::get<chaiscript::Boxed_Value>(value)).get_as<long>();
+    if (n < 0) {
+        return form::Special{"RuntimeError", "Print limits can't be negative", std::nullopt};
+    }
+    *limit = n;
+    return value;
+}
+
+form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai, const Print_Limits & limits, std::size_t level) {
     if (bv.is_null()) {
         return token::Token{std::string("nil"), token::type::SYMBOL, 0, 0};
     }
 
+    const bool too_deep = limits.level && level >= *limits.level;
+    const std::size_t max_items = too_deep ? 0 : limits.length ? *limits.length + 1 : std::numeric_limits<std::size_t>::max();
+
+    if (bv.get_type_info().bare_equal(chaiscript::user_type<core::List>()) || bv.get_type_info().bare_equal(chaiscript::user_type<core::Rest_Args>())) {
+        const chaiscript::Boxed_Value* first;
+        const chaiscript::Boxed_Value* last;
+        core::items(bv, first, last);
+        std::list<form::FormWrapper> new_list;
+        for (auto it = first; it != last && new_list.size() < max_items; ++it) {
+            new_list.push_back(form::FormWrapper{chai_to_form(*it, chai, limits, level + 1)});
+        }
+        return new_list;
+    }
+
     try {
-        auto vec = chai->boxed_cast<std::vector<chaiscript::Boxed_Value>>(bv);
+        const auto & vec = chai->boxed_cast<const std::vector<chaiscript::Boxed_Value> &>(bv);
         auto new_vec = std::vector<form::FormWrapper>();
+        new_vec.reserve(std::min(vec.size(), max_items));
 
-        for (auto it = vec.begin(); it != vec.end(); ++it) {
-            new_vec.push_back(form::FormWrapper{chai_to_form(*it, chai)});
+        for (auto it = vec.begin(); it != vec.end() && new_vec.size() < max_items; ++it) {
+            new_vec.push_back(form::FormWrapper{chai_to_form(*it, chai, limits, level + 1)});
         }
 
         return new_vec;
     } catch (const chaiscript::exception::bad_boxed_cast &) {}
 
     try {
-        auto map = chai->boxed_cast<std::map<std::string, chaiscript::Boxed_Value>>(bv);
+        const auto & map = chai->boxed_cast<const std::map<std::string, chaiscript::Boxed_Value> &>(bv);
         auto new_map = std::make_shared<form::FormWrapperMap>(form::FormWrapperMap{});
-        auto new_set = std::make_shared<form::FormWrapperSet>(form::FormWrapperSet{});
         auto new_map_it = new_map->begin();
-        auto new_set_it = new_set->begin();
 
-        for (auto it = map.begin(); it != map.end(); ++it) {
+        for (auto it = map.begin(); it != map.end() && new_map->size() < max_items; ++it) {
             auto key_str = (*it).first;
             auto forms = read(key_str);
             if (forms.size() != 1) {
                 return form::Special{"RuntimeError", "Failed to parse " + std::string(key_str), std::nullopt};
             }
             auto key = form::FormWrapper{forms.front()};
-            auto val = form::FormWrapper{chai_to_form((*it).second, chai)};
+            auto val = form::FormWrapper{chai_to_form((*it).second, chai, limits, level + 1)};
             new_map->insert(new_map_it, std::pair(key, val));
-            if (key == val) {
-                new_set->insert(new_set_it, val);
+        }
+
+        return new_map;
+    } catch (const chaiscript::exception::bad_boxed_cast &) {}
+
+    try {
+        const auto & set = chai->boxed_cast<const core::Hash_Set &>(bv);
+        auto new_set = std::make_shared<form::FormWrapperSet>(form::FormWrapperSet{});
+        auto new_set_it = new_set->begin();
+
+        for (auto it = set.items.begin(); it != set.items.end() && new_set->size() < max_items; ++it) {
+            new_set->insert(new_set_it, form::FormWrapper{chai_to_form((*it).second, chai, limits, level + 1)});
+        }
+
+        return new_set;
+    } catch (const chaiscript::exception::bad_boxed_cast &) {}
+
+    try {
+        const auto & map = chai->boxed_cast<const core::Sorted_Map &>(bv);
+        auto new_map = std::make_shared<form::SortedFormMap>();
+        if (max_items > 0) {
+            map.for_each([&](const core::Sorted_Map::Entry & e) {
+                new_map->entries.emplace_back(form::FormWrapper{chai_to_form(e.first, chai, limits, level + 1)},
+                                              form::FormWrapper{chai_to_form(e.second, chai, limits, level + 1)});
+                return new_map->entries.size() < max_items;
+            });
+        }
+        return new_map;
+    } catch (const chaiscript::exception::bad_boxed_cast &) {}
+
+    if (bv.get_type_info().bare_equal(chaiscript::user_type<core::Keyword>())) {
+        return token::Token{*chai->boxed_cast<const core::Keyword &>(bv).name, token::type::SYMBOL, 0, 0};
+    }
+
+    if (bv.get_type_info().bare_equal(chaiscript::user_type<core::Symbol>())) {
+        return token::Token{*chai->boxed_cast<const core::Symbol &>(bv).name, token::type::SYMBOL, 0, 0};
+    }
+
+    try {
+        const auto & record = chai->boxed_cast<const core::Record &>(bv);
+        auto new_map = std::make_shared<form::FormWrapperMap>(form::FormWrapperMap{});
+        auto add = [&](const core::Keyword & k, const chaiscript::Boxed_Value & v) {
+            if (new_map->size() < max_items) {
+                new_map->emplace(form::FormWrapper{token::Token{*k.name, token::type::SYMBOL, 0, 0}},
+                                 form::FormWrapper{chai_to_form(v, chai, limits, level + 1)});
             }
+        };
+        for (std::size_t i = 0; i < record.slots.size(); i++) {
+            add(record.type->fields[i], record.slots[i]);
+        }
+        for (const auto & e : record.overflow) {
+            add(e.first, e.second);
         }
+        return new_map;
+    } catch (const chaiscript::exception::bad_boxed_cast &) {}
 
-        if (new_map->size() == new_set->size()) {
-            return new_set;
-        } else {
-            return new_map;
+    try {
+        const auto & set = chai->boxed_cast<const core::Sorted_Set &>(bv);
+        auto new_set = std::make_shared<form::SortedFormSet>();
+        if (max_items > 0) {
+            set.map.for_each([&](const core::Sorted_Map::Entry & e) {
+                new_set->items.emplace_back(chai_to_form(e.first, chai, limits, level + 1));
+                return new_set->items.size() < max_items;
+            });
         }
+        return new_set;
     } catch (const chaiscript::exception::bad_boxed_cast &) {}
 
     try {
@@ -293,6 +1470,14 @@ form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai
         return token::Token{chai->boxed_cast<std::string>(bv), token::type::STRING, 0, 0};
     } catch (const chaiscript::exception::bad_boxed_cast &) {}
 
+    if (bv.get_type_info().bare_equal(chaiscript::user_type<core::Pattern>())) {
+        return form::Special{"Pattern", chai->boxed_cast<const core::Pattern &>(bv).regex->source, std::nullopt};
+    }
+
+    if (bv.get_type_info().bare_equal(chaiscript::user_type<core::Transducer>())) {
+        return form::Special{"Object", "transducer", std::nullopt};
+    }
+
     try {
         chai->boxed_cast<evaled::fn::Zero>(bv);
         return form::Special{"Object", "function", std::nullopt};
@@ -307,6 +1492,8 @@ form::Form chai_to_form(chaiscript::Boxed_Value bv, chaiscript::ChaiScript* chai
 }
 
 std::list<form::Form> eval(std::list<form::Form> forms, chaiscript::ChaiScript* chai) {
+    // functions are called through std::function below, outside chai->eval, so charge them explicitly
+    const auto memory_scope = chai->memory_scope();
     std::list<form::Form> new_forms;
     for (auto form : forms) {
         try {
@@ -314,21 +1501,34 @@ std::list<form::Form> eval(std::list<form::Form> forms, chaiscript::ChaiScript*
             switch (evaled_form.index()) {
                 case evaled::SPECIAL:
                     {
+                        metrics::local().errors.add(1);
                         new_forms.push_back(std::get<form::Special>(evaled_form));
                         break;
                     }
                 case evaled::CHAI:
                     {
-                        auto ret = chai_to_form(std::get<chaiscript::Boxed_Value>(evaled_form), chai);
+                        auto ret = chai_to_form(std::get<chaiscript::Boxed_Value>(evaled_form), chai, print_limits());
                         new_forms.push_back(ret);
                         break;
                     }
             }
         } catch (const chaiscript::exception::eval_error &e) {
+            metrics::local().exceptions.add(1);
             new_forms.push_back(form::Special{"RuntimeError", e.what(), std::nullopt});
         } catch (const chaiscript::exception::bad_boxed_cast &e) {
+            metrics::local().exceptions.add(1);
             new_forms.push_back(form::Special{"RuntimeError", e.what(), std::nullopt});
         } catch (const chaiscript::detail::exception::bad_any_cast &e) {
+            metrics::local().exceptions.add(1);
+            new_forms.push_back(form::Special{"RuntimeError", e.what(), std::nullopt});
+        } catch (const evaled::Error &e) {
+            metrics::local().exceptions.add(1);
+            new_forms.push_back(e.special);
+        } catch (const chaiscript::exception::memory_limit_error &e) {
+            metrics::local().exceptions.add(1);
+            new_forms.push_back(form::Special{"MemoryError", e.what(), std::nullopt});
+        } catch (const std::exception &e) {
+            metrics::local().exceptions.add(1);
             new_forms.push_back(form::Special{"RuntimeError", e.what(), std::nullopt});
         }
     }
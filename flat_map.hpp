@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace zachlisp {
+
+    // zachlisp::flat
+    // a hash map with open addressing that keeps its entries in one array, in the order
+    // they were added. the table only holds entry indices and is probed linearly; each
+    // slot keeps its entry's hash, so most mismatches are rejected without comparing keys
+    namespace flat {
+
+    template <class K, class V, class Hash, class Equal>
+    class Map {
+    public:
+        using Entry = std::pair<K, V>;
+
+        explicit Map(Hash h = Hash(), Equal e = Equal()) : hash(h), equal(e) {}
+
+        std::size_t size() const {
+            return items.size();
+        }
+
+        // the value for key, added default-constructed if key is missing
+        V & operator[](const K & key) {
+            if ((items.size() + 1) * 2 > slots.size()) {
+                grow();
+            }
+            const std::size_t h = hash(key);
+            const std::size_t mask = slots.size() - 1;
+            for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+                auto & slot = slots[i];
+                if (slot.index == 0) {
+                    items.emplace_back(key, V());
+                    slot = Slot{h, items.size()};
+                    return items.back().second;
+                }
+                if (slot.hash == h && equal(items[slot.index - 1].first, key)) {
+                    return items[slot.index - 1].second;
+                }
+            }
+        }
+
+        // in the order they were added. values may be changed, keys may not
+        std::vector<Entry> & entries() {
+            return items;
+        }
+
+        const std::vector<Entry> & entries() const {
+            return items;
+        }
+
+    private:
+        struct Slot {
+            std::size_t hash;
+            // one past the entry's index, 0 for an empty slot
+            std::size_t index;
+        };
+
+        void grow() {
+            std::vector<Slot> bigger(std::max<std::size_t>(16, slots.size() * 2), Slot{0, 0});
+            const std::size_t mask = bigger.size() - 1;
+            for (const auto & slot : slots) {
+                if (slot.index != 0) {
+                    auto i = slot.hash & mask;
+                    while (bigger[i].index != 0) {
+                        i = (i + 1) & mask;
+                    }
+                    bigger[i] = slot;
+                }
+            }
+            slots.swap(bigger);
+        }
+
+        std::vector<Entry> items;
+        std::vector<Slot> slots;
+        Hash hash;
+        Equal equal;
+    };
+
+    }
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+
+namespace zachlisp {
+
+    // zachlisp::hash
+    // a wyhash-style hash: input is folded in 8 bytes at a time through 64x64 -> 128 bit
+    // multiplies. everything is keyed by a seed picked when the process starts, so keys
+    // that collide in one run can't be precomputed from the source and fed to another
+    namespace hash {
+
+    const std::uint64_t P0 = 0xa0761d6478bd642fULL;
+    const std::uint64_t P1 = 0xe7037ed1a0b428dbULL;
+    const std::uint64_t P2 = 0x8ebc6af09c88c6e3ULL;
+    const std::uint64_t P3 = 0x589965cc75374cc3ULL;
+
+    // multiplies a and b and folds the high half of the product into the low half
+    inline std::uint64_t mum(std::uint64_t a, std::uint64_t b) {
+        const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+        return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+    }
+
+    inline std::uint64_t read64(const unsigned char* p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+
+    inline std::uint64_t read32(const unsigned char* p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+
+    // reads 1 to 3 bytes
+    inline std::uint64_t read_small(const unsigned char* p, std::size_t n) {
+        return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[n >> 1]) << 8) | p[n - 1];
+    }
+
+    // never throws, so hashing can be noexcept: random_device throws where there's no
+    // entropy source, and then the clock alone picks the seed
+    inline std::uint64_t seed() noexcept {
+        static const std::uint64_t s = [] {
+            std::uint64_t s = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+            try {
+                std::random_device device;
+                s ^= (std::uint64_t(device()) << 32) ^ device();
+            } catch (const std::exception &) {}
+            return mum(s ^ P0, P1) | 1;
+        }();
+        return s;
+    }
+
+    inline std::size_t bytes(const void* data, std::size_t n) {
+        auto p = static_cast<const unsigned char*>(data);
+        static const std::uint64_t start = seed() ^ mum(seed() ^ P0, P1);
+        std::uint64_t s = start;
+        std::uint64_t a;
+        std::uint64_t b;
+        if (n <= 16) {
+            if (n >= 4) {
+                const std::size_t middle = (n >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + middle);
+                b = (read32(p + n - 4) << 32) | read32(p + n - 4 - middle);
+            } else if (n > 0) {
+                a = read_small(p, n);
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            std::size_t i = n;
+            if (i > 48) {
+                // three independent lanes so the multiplies can overlap
+                std::uint64_t s1 = s;
+                std::uint64_t s2 = s;
+                do {
+                    s = mum(read64(p) ^ P1, read64(p + 8) ^ s);
+                    s1 = mum(read64(p + 16) ^ P2, read64(p + 24) ^ s1);
+                    s2 = mum(read64(p + 32) ^ P3, read64(p + 40) ^ s2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                s ^= s1 ^ s2;
+            }
+            while (i > 16) {
+                s = mum(read64(p) ^ P1, read64(p + 8) ^ s);
+                p += 16;
+                i -= 16;
+            }
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+        const unsigned __int128 r = static_cast<unsigned __int128>(a ^ P1) * (b ^ s);
+        return mum(static_cast<std::uint64_t>(r) ^ P0 ^ n, static_cast<std::uint64_t>(r >> 64) ^ P1);
+    }
+
+    inline std::size_t string(const std::string & s) {
+        return bytes(s.data(), s.size());
+    }
+
+    inline std::size_t integer(std::uint64_t x) {
+        const unsigned __int128 r = static_cast<unsigned __int128>(x ^ seed() ^ P0) * (seed() ^ P1);
+        return mum(static_cast<std::uint64_t>(r) ^ P0, static_cast<std::uint64_t>(r >> 64) ^ P1);
+    }
+
+    // 0.0 and -0.0 hash alike, since they compare equal
+    inline std::size_t floating(double d) {
+        d += 0.0;
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof bits);
+        return integer(bits);
+    }
+
+    // order matters: combine(combine(h, a), b) and combine(combine(h, b), a) differ
+    inline std::size_t combine(std::size_t h, std::size_t v) {
+        return mum(h ^ seed() ^ P2, v ^ P3);
+    }
+
+    // for unordered containers keyed by strings that come from input
+    struct String_Hash {
+        std::size_t operator()(const std::string & s) const {
+            return string(s);
+        }
+    };
+
+    }
+
+}
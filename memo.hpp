@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace zachlisp {
+
+    // zachlisp::memo
+    // a bounded cache for memoized functions. keys are spread over stripes by hash, each
+    // stripe with its own lock, table and share of the capacity, so threads looking up
+    // different keys rarely wait on each other. a full stripe evicts with CLOCK: every
+    // entry has a reference bit set on each hit, and the hand sweeps the entries clearing
+    // bits until it reaches one that hasn't been used since the last sweep
+    namespace memo {
+
+    struct Stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+        std::size_t size = 0;
+        std::size_t capacity = 0;
+    };
+
+    template <class K, class V, class Hash, class Equal>
+    class Cache {
+    public:
+        static const std::size_t MAX_STRIPES = 16;
+        // eviction only sees one stripe, so small caches get fewer stripes to keep it
+        // close to LRU over the whole cache
+        static const std::size_t MIN_STRIPE_CAPACITY = 64;
+
+        explicit Cache(std::size_t capacity, Hash h = Hash(), Equal e = Equal()) : hash(h), equal(e) {
+            capacity = std::max<std::size_t>(capacity, 1);
+            // a power of two
+            std::size_t n = 1;
+            while (n * 2 <= std::min(capacity / MIN_STRIPE_CAPACITY, MAX_STRIPES)) {
+                n *= 2;
+            }
+            stripes = std::unique_ptr<Stripe[]>(new Stripe[n]);
+            mask = n - 1;
+            for (std::size_t i = 0; i < n; i++) {
+                stripes[i].capacity = capacity * (i + 1) / n - capacity * i / n;
+                stripes[i].index = Index(0, Key_Hash(), Key_Equal{&equal});
+            }
+        }
+
+        Cache(const Cache &) = delete;
+        Cache & operator=(const Cache &) = delete;
+
+        // copies the value cached for key into out, marking it recently used
+        bool find(const K & key, V & out) {
+            const std::size_t h = hash(key);
+            auto & s = stripe(h);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            const auto it = s.index.find(Key{&key, h});
+            if (it == s.index.end()) {
+                s.misses++;
+                return false;
+            }
+            auto & entry = s.ring[it->second];
+            entry.referenced = true;
+            out = entry.value;
+            s.hits++;
+            return true;
+        }
+
+        // caches value for key and returns what is now cached for it. when another thread
+        // cached the key first its value is kept, so every caller sees the same result
+        V insert(const K & key, const V & value) {
+            const std::size_t h = hash(key);
+            auto & s = stripe(h);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            const auto it = s.index.find(Key{&key, h});
+            if (it != s.index.end()) {
+                return s.ring[it->second].value;
+            }
+            std::size_t slot;
+            if (s.ring.size() < s.capacity) {
+                slot = s.ring.size();
+                s.ring.push_back(Entry{key, value, h, false});
+            } else {
+                while (s.ring[s.hand].referenced) {
+                    s.ring[s.hand].referenced = false;
+                    s.hand = (s.hand + 1) % s.ring.size();
+                }
+                slot = s.hand;
+                s.hand = (s.hand + 1) % s.ring.size();
+                auto & victim = s.ring[slot];
+                s.index.erase(Key{&victim.key, victim.hash});
+                victim = Entry{key, value, h, false};
+                s.evictions++;
+            }
+            s.index.emplace(Key{&s.ring[slot].key, h}, slot);
+            return value;
+        }
+
+        Stats stats() const {
+            Stats ret;
+            for (std::size_t i = 0; i <= mask; i++) {
+                auto & s = stripes[i];
+                std::lock_guard<std::mutex> lock(s.mutex);
+                ret.hits += s.hits;
+                ret.misses += s.misses;
+                ret.evictions += s.evictions;
+                ret.size += s.ring.size();
+                ret.capacity += s.capacity;
+            }
+            return ret;
+        }
+
+    private:
+        struct Entry {
+            K key;
+            V value;
+            std::size_t hash;
+            bool referenced;
+        };
+
+        // the index points into the ring, so keys are stored once and hashed once
+        struct Key {
+            const K* key;
+            std::size_t hash;
+        };
+
+        struct Key_Hash {
+            std::size_t operator()(const Key & k) const {
+                return k.hash;
+            }
+        };
+
+        struct Key_Equal {
+            const Equal* equal;
+
+            bool operator()(const Key & a, const Key & b) const {
+                return a.hash == b.hash && (*equal)(*a.key, *b.key);
+            }
+        };
+
+        using Index = std::unordered_map<Key, std::size_t, Key_Hash, Key_Equal>;
+
+        // padded to a cache line so neighbouring stripes' locks don't share one
+        struct alignas(64) Stripe {
+            mutable std::mutex mutex;
+            Index index;
+            // a deque, so entries never move once added: the index points at their keys.
+            // an evicted entry is overwritten in place
+            std::deque<Entry> ring;
+            std::size_t hand = 0;
+            std::size_t capacity = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+        };
+
+        // the high bits pick the stripe, leaving the low bits to the stripe's table
+        Stripe & stripe(std::size_t h) {
+            return stripes[(h >> 48) & mask];
+        }
+
+        Hash hash;
+        Equal equal;
+        std::unique_ptr<Stripe[]> stripes;
+        std::size_t mask;
+    };
+
+    }
+
+}
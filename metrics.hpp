@@ -0,0 +1,372 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "read.hpp"
+#include "chaiscript/chaiscript_allocator.hpp"
+
+namespace zachlisp {
+
+    // zachlisp::metrics
+    // latency histograms and counters for top-level evaluation. every thread records into
+    // its own set without locking; snapshot() merges them when the metrics are exported
+    namespace metrics {
+
+    // values below 2^SUB_BITS are counted exactly, above that every power of two
+    // is split into 2^SUB_BITS buckets, so quantiles are within ~3% of the true value.
+    // values of 2^MAX_BITS (about 18 minutes in nanoseconds) and more share the last bucket
+    const int SUB_BITS = 5;
+    const int MAX_BITS = 40;
+    const std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BITS;
+    const std::size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    inline int highest_bit(std::uint64_t value) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        int bit = 0;
+        while (value >>= 1) {
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    inline std::size_t bucket(std::uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        value = std::min(value, (std::uint64_t(1) << MAX_BITS) - 1);
+        const int shift = highest_bit(value) - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+    }
+
+    // largest value that lands in bucket i
+    inline std::uint64_t bucket_max(std::size_t i) {
+        if (i < SUB_BUCKETS) {
+            return i;
+        }
+        const std::size_t shift = i / SUB_BUCKETS - 1;
+        const std::uint64_t sub = i % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    // a counter written by one thread and read by any
+    class Counter {
+    public:
+        void add(std::uint64_t n) {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::uint64_t get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    // a histogram written by one thread and read by any
+    class Histogram {
+    public:
+        void record(std::uint64_t value) {
+            counts[bucket(value)].add(1);
+            sum.add(value);
+        }
+
+        std::array<Counter, BUCKETS> counts;
+        Counter sum;
+    };
+
+    struct Histogram_Snapshot {
+        std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(BUCKETS);
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+
+        void merge(const Histogram & h) {
+            for (std::size_t i = 0; i < BUCKETS; i++) {
+                const auto n = h.counts[i].get();
+                counts[i] += n;
+                count += n;
+            }
+            sum += h.sum.get();
+        }
+
+        void merge(const Histogram_Snapshot & h) {
+            for (std::size_t i = 0; i < BUCKETS; i++) {
+                counts[i] += h.counts[i];
+            }
+            count += h.count;
+            sum += h.sum;
+        }
+
+        std::uint64_t quantile(double q) const {
+            const auto rank = static_cast<std::uint64_t>(q * count);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < BUCKETS; i++) {
+                seen += counts[i];
+                if (seen > rank) {
+                    return bucket_max(i);
+                }
+            }
+            return count == 0 ? 0 : bucket_max(BUCKETS - 1);
+        }
+    };
+
+    const std::array<const char*, 8> FORM_NAMES = {"special", "token", "list", "vector", "map", "set", "sorted-map", "sorted-set"};
+
+    // everything one thread records
+    struct Thread_Metrics {
+        Histogram read;
+        std::array<Histogram, FORM_NAMES.size()> eval;
+        std::array<Histogram, FORM_NAMES.size()> print;
+        Counter errors;
+        Counter exceptions;
+        Counter allocations;
+        Counter allocated_bytes;
+        Counter site_cache_hits;
+        Counter site_cache_misses;
+    };
+
+    struct Snapshot {
+        Histogram_Snapshot read;
+        std::array<Histogram_Snapshot, FORM_NAMES.size()> eval;
+        std::array<Histogram_Snapshot, FORM_NAMES.size()> print;
+        std::uint64_t errors = 0;
+        std::uint64_t exceptions = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t allocated_bytes = 0;
+        std::uint64_t site_cache_hits = 0;
+        std::uint64_t site_cache_misses = 0;
+
+        void merge(const Thread_Metrics & m) {
+            read.merge(m.read);
+            for (std::size_t i = 0; i < FORM_NAMES.size(); i++) {
+                eval[i].merge(m.eval[i]);
+                print[i].merge(m.print[i]);
+            }
+            errors += m.errors.get();
+            exceptions += m.exceptions.get();
+            allocations += m.allocations.get();
+            allocated_bytes += m.allocated_bytes.get();
+            site_cache_hits += m.site_cache_hits.get();
+            site_cache_misses += m.site_cache_misses.get();
+        }
+
+        void merge(const Snapshot & s) {
+            read.merge(s.read);
+            for (std::size_t i = 0; i < FORM_NAMES.size(); i++) {
+                eval[i].merge(s.eval[i]);
+                print[i].merge(s.print[i]);
+            }
+            errors += s.errors;
+            exceptions += s.exceptions;
+            allocations += s.allocations;
+            allocated_bytes += s.allocated_bytes;
+            site_cache_hits += s.site_cache_hits;
+            site_cache_misses += s.site_cache_misses;
+        }
+    };
+
+    // the metrics of live threads, and the totals of threads that have exited
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Thread_Metrics>> threads;
+        Snapshot retired;
+    };
+
+    Registry & registry() {
+        // never destroyed: threads may still exit during static destruction
+        static Registry* r = new Registry();
+        return *r;
+    }
+
+    // registers this thread's metrics on first use and folds them into the totals on exit
+    class Thread_Slot {
+    public:
+        Thread_Slot() : metrics(std::make_shared<Thread_Metrics>()) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().threads.push_back(metrics);
+        }
+
+        ~Thread_Slot() {
+            auto & r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.retired.merge(*metrics);
+            r.threads.erase(std::find(r.threads.begin(), r.threads.end(), metrics));
+        }
+
+        std::shared_ptr<Thread_Metrics> metrics;
+    };
+
+    Thread_Metrics & local() {
+        thread_local Thread_Slot slot;
+        return *slot.metrics;
+    }
+
+    Snapshot snapshot() {
+        auto & r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        Snapshot s;
+        s.merge(r.retired);
+        for (const auto & t : r.threads) {
+            s.merge(*t);
+        }
+        return s;
+    }
+
+    // counts one lookup in an evaluator's cache at a place in the source (token::Site_Cache):
+    // compiled let* and fn* patterns, quote templates and record field slots
+    void site_cache(bool hit) {
+        auto & m = local();
+        (hit ? m.site_cache_hits : m.site_cache_misses).add(1);
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    // records the lifetime of the timer in a histogram, in nanoseconds
+    class Timer {
+    public:
+        explicit Timer(Histogram & h) : histogram(h), start(Clock::now()) {}
+
+        ~Timer() {
+            histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+
+        Timer(const Timer &) = delete;
+        Timer & operator=(const Timer &) = delete;
+
+    private:
+        Histogram & histogram;
+        Clock::time_point start;
+    };
+
+    // times the evaluation of one top-level form and counts the allocations it makes
+    class Eval_Timer {
+    public:
+        explicit Eval_Timer(const form::Form & form)
+            : timer(local().eval[form.index()]),
+              start(chaiscript::detail::Allocation_Counter::thread()) {}
+
+        ~Eval_Timer() {
+            const auto & end = chaiscript::detail::Allocation_Counter::thread();
+            local().allocations.add(end.allocations - start.allocations);
+            local().allocated_bytes.add(end.bytes - start.bytes);
+        }
+
+    private:
+        Timer timer;
+        chaiscript::detail::Allocation_Counter start;
+    };
+
+    void write_summary(std::ostream & out, const std::string & name, const std::string & labels, const Histogram_Snapshot & h) {
+        const std::string prefix = labels.empty() ? "{" : "{" + labels + ",";
+        for (auto q : {"0.5", "0.99", "0.999"}) {
+            out << name << prefix << "quantile=\"" << q << "\"} " << h.quantile(std::stod(q)) / 1e9 << "\n";
+        }
+        const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+        out << name << "_sum" << suffix << " " << h.sum / 1e9 << "\n";
+        out << name << "_count" << suffix << " " << h.count << "\n";
+    }
+
+    // renders a snapshot in the Prometheus text exposition format
+    std::string prometheus(const Snapshot & s) {
+        std::ostringstream out;
+        out << "# HELP zachlisp_read_seconds Time to read one line of input.\n";
+        out << "# TYPE zachlisp_read_seconds summary\n";
+        write_summary(out, "zachlisp_read_seconds", "", s.read);
+
+        out << "# HELP zachlisp_eval_seconds Time to evaluate one top-level form, by form type.\n";
+        out << "# TYPE zachlisp_eval_seconds summary\n";
+        for (std::size_t i = 0; i < FORM_NAMES.size(); i++) {
+            if (s.eval[i].count > 0) {
+                write_summary(out, "zachlisp_eval_seconds", "form=\"" + std::string(FORM_NAMES[i]) + "\"", s.eval[i]);
+            }
+        }
+
+        out << "# HELP zachlisp_print_seconds Time to print the result of one top-level form, by form type.\n";
+        out << "# TYPE zachlisp_print_seconds summary\n";
+        for (std::size_t i = 0; i < FORM_NAMES.size(); i++) {
+            if (s.print[i].count > 0) {
+                write_summary(out, "zachlisp_print_seconds", "form=\"" + std::string(FORM_NAMES[i]) + "\"", s.print[i]);
+            }
+        }
+
+        const std::array<std::tuple<const char*, const char*, std::uint64_t>, 6> counters = {{
+            {"errors", "Top-level forms that evaluated to an error.", s.errors},
+            {"exceptions", "Exceptions caught while evaluating top-level forms.", s.exceptions},
+            {"allocations", "Slab allocations made while evaluating top-level forms.", s.allocations},
+            {"allocated_bytes", "Bytes of slab allocations made while evaluating top-level forms.", s.allocated_bytes},
+            {"site_cache_hits", "Lookups that found what they needed in a call site's cache.", s.site_cache_hits},
+            {"site_cache_misses", "Lookups that had to compile or search because a call site's cache missed.", s.site_cache_misses}
+        }};
+        for (const auto & c : counters) {
+            const auto name = "zachlisp_" + std::string(std::get<0>(c)) + "_total";
+            out << "# HELP " << name << " " << std::get<1>(c) << "\n";
+            out << "# TYPE " << name << " counter\n";
+            out << name << " " << std::get<2>(c) << "\n";
+        }
+        return out.str();
+    }
+
+    // rewrites a file with the current metrics every interval, in the style of a
+    // node_exporter textfile collector; the file is replaced atomically
+    class Exporter {
+    public:
+        Exporter(std::string p, std::chrono::milliseconds i) : path(p), interval(i), thread([this]() { run(); }) {}
+
+        ~Exporter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+            write();
+        }
+
+        Exporter(const Exporter &) = delete;
+        Exporter & operator=(const Exporter &) = delete;
+
+        void write() const {
+            const auto tmp = path + ".tmp";
+            {
+                std::ofstream out(tmp);
+                out << prometheus(snapshot());
+            }
+            std::rename(tmp.c_str(), path.c_str());
+        }
+
+    private:
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+                write();
+            }
+        }
+
+        std::string path;
+        std::chrono::milliseconds interval;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    }
+
+}
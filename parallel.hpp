@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace zachlisp {
+
+    // zachlisp::parallel
+    // helpers for splitting native builtins' work over the hardware threads
+    namespace parallel {
+
+    // how many pieces of at least min_size to cut n items into, one per hardware thread at most
+    inline std::size_t pieces(std::size_t n, std::size_t min_size) {
+        return std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(), n / min_size));
+    }
+
+    // calls f(0) ... f(n - 1) on n threads, this one included, and rethrows the first exception
+    template <class F>
+    void run_all(std::size_t n, F f) {
+        std::vector<std::exception_ptr> errors(n);
+        auto guarded = [&](std::size_t i) {
+            try {
+                f(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> threads;
+        try {
+            for (std::size_t i = 1; i < n; i++) {
+                threads.emplace_back(guarded, i);
+            }
+        } catch (...) {
+            // a thread that couldn't start leaves the ones that did joinable, and destroying
+            // those would terminate, so wait for them before passing the error on
+            for (auto & t : threads) {
+                t.join();
+            }
+            throw;
+        }
+        guarded(0);
+        for (auto & t : threads) {
+            t.join();
+        }
+        for (const auto & e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    }
+
+}
@@ -1,11 +1,12 @@
 #pragma once
 
 #include "read.hpp"
+#include "text.hpp"
 
 namespace zachlisp {
 
-std::string escape_str(std::string s) {
-    return std::regex_replace(s, std::regex("\""), "\\\"");
+std::string escape_str(const std::string & s) {
+    return text::escape(s);
 }
 
 std::string pr_str(token::Token token) {
@@ -31,40 +32,73 @@ std::string pr_str(token::Token token) {
     return "";
 }
 
-std::string pr_str(form::Form form);
+// bounds on how much of a form is printed, like clojure's *print-length* and *print-level*:
+// collections show at most length items followed by "...", and collections nested
+// level or more deep are printed as "#" without being visited
+struct Print_Limits {
+    std::optional<std::size_t> length;
+    std::optional<std::size_t> level;
+};
 
-std::string pr_str(form::FormWrapper formWrapper) {
-    return pr_str(formWrapper.form);
+// the limits print() applies, set with (set! *print-length* n) and (set! *print-level* n).
+// like clojure's vars they are bound per thread, so engines evaluating on other threads
+// neither see nor race with the REPL's settings
+Print_Limits & print_limits() {
+    thread_local Print_Limits limits;
+    return limits;
 }
 
-std::string pr_str(std::string s) {
+std::string pr_str(const form::Form & form, const Print_Limits & limits = {}, std::size_t level = 0);
+
+std::string pr_str(const form::FormWrapper & formWrapper, const Print_Limits & limits, std::size_t level) {
+    return pr_str(formWrapper.form, limits, level);
+}
+
+std::string pr_str(const std::string & s, const Print_Limits &, std::size_t) {
     return s;
 }
 
 template <class T>
-std::string pr_str(T list) {
+std::string pr_str(const T & list, const Print_Limits & limits, std::size_t level) {
     std::string s;
-    for (auto item : list) {
+    std::size_t count = 0;
+    for (const auto & item : list) {
         if (s.size() > 0) {
             s += " ";
         }
-        s += pr_str(item);
+        if (limits.length && count == *limits.length) {
+            s += "...";
+            break;
+        }
+        s += pr_str(item, limits, level);
+        count++;
     }
     return s;
 }
 
-std::string pr_str(form::FormWrapperMap map) {
+// the entries of a hashed or sorted map
+template <class T>
+std::string pr_entries(const T & map, const Print_Limits & limits, std::size_t level) {
     std::string s;
-    for (auto item : map) {
+    std::size_t count = 0;
+    for (const auto & item : map) {
         if (s.size() > 0) {
             s += " ";
         }
-        s += pr_str(item.first.form) + " " + pr_str(item.second.form);
+        if (limits.length && count == *limits.length) {
+            s += "...";
+            break;
+        }
+        s += pr_str(item.first.form, limits, level) + " " + pr_str(item.second.form, limits, level);
+        count++;
     }
     return s;
 }
 
-std::string pr_str(form::Form form) {
+std::string pr_str(const form::Form & form, const Print_Limits & limits, std::size_t level) {
+    if (form.index() != form::SPECIAL && form.index() != form::TOKEN && limits.level && level >= *limits.level) {
+        return "#";
+    }
     switch (form.index()) {
         case form::SPECIAL:
             {
@@ -74,21 +108,25 @@ std::string pr_str(form::Form form) {
         case form::TOKEN:
             return pr_str(std::get<token::Token>(form));
         case form::LIST:
-            return "(" + pr_str<std::list<form::FormWrapper> >(std::get<std::list<form::FormWrapper> >(form)) + ")";
+            return "(" + pr_str<std::list<form::FormWrapper> >(std::get<std::list<form::FormWrapper> >(form), limits, level + 1) + ")";
         case form::VECTOR:
-            return "[" + pr_str<std::vector<form::FormWrapper> >(std::get<std::vector<form::FormWrapper> >(form)) + "]";
+            return "[" + pr_str<std::vector<form::FormWrapper> >(std::get<std::vector<form::FormWrapper> >(form), limits, level + 1) + "]";
         case form::MAP:
-            return "{" + pr_str(*std::get<std::shared_ptr<form::FormWrapperMap>>(form)) + "}";
+            return "{" + pr_entries(*std::get<std::shared_ptr<form::FormWrapperMap>>(form), limits, level + 1) + "}";
         case form::SET:
-            return "#{" + pr_str<form::FormWrapperSet>(*std::get<std::shared_ptr<form::FormWrapperSet>>(form)) + "}";
+            return "#{" + pr_str<form::FormWrapperSet>(*std::get<std::shared_ptr<form::FormWrapperSet>>(form), limits, level + 1) + "}";
+        case form::SORTED_MAP:
+            return "{" + pr_entries(std::get<std::shared_ptr<form::SortedFormMap>>(form)->entries, limits, level + 1) + "}";
+        case form::SORTED_SET:
+            return "#{" + pr_str<std::vector<form::FormWrapper>>(std::get<std::shared_ptr<form::SortedFormSet>>(form)->items, limits, level + 1) + "}";
     }
     return "";
 }
 
-std::string print(const std::list<form::Form> forms) {
+std::string print(const std::list<form::Form> & forms) {
     std::string s;
-    for (auto form : forms) {
-        s += pr_str(form) + "\n";
+    for (const auto & form : forms) {
+        s += pr_str(form, print_limits()) + "\n";
     }
     return s;
 }
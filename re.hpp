@@ -0,0 +1,1099 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hash.hpp"
+
+namespace zachlisp {
+
+    // zachlisp::re
+    // regular expressions that run in time linear in the text. a pattern is parsed and
+    // compiled to a Thompson NFA over UTF-8 bytes. searches run lazily built DFAs: one
+    // forward to find where the first match ends, one over the reversed program backward
+    // to find where it starts. the NFA itself is only simulated, as a Pike VM, to fill in
+    // capture groups over the match the DFAs found
+    namespace re {
+
+    // a set of code points as sorted, disjoint, inclusive ranges
+    using Ranges = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+    const std::uint32_t MAX_CODE_POINT = 0x10ffff;
+    // bounds on what one pattern may compile to
+    const int MAX_REPEAT = 1000;
+    // groups nest by recursion, in the parser and in everything that walks the tree
+    const int MAX_NESTING = 1000;
+    const std::size_t MAX_PROGRAM = 100000;
+
+    inline Ranges normalise(Ranges r) {
+        std::sort(r.begin(), r.end());
+        Ranges ret;
+        for (const auto & range : r) {
+            if (!ret.empty() && range.first <= ret.back().second + 1) {
+                ret.back().second = std::max(ret.back().second, range.second);
+            } else {
+                ret.push_back(range);
+            }
+        }
+        return ret;
+    }
+
+    // r must be normalised
+    inline Ranges negate(const Ranges & r) {
+        Ranges ret;
+        std::uint32_t next = 0;
+        for (const auto & range : r) {
+            if (range.first > next) {
+                ret.emplace_back(next, range.first - 1);
+            }
+            next = range.second + 1;
+        }
+        if (next <= MAX_CODE_POINT) {
+            ret.emplace_back(next, MAX_CODE_POINT);
+        }
+        return ret;
+    }
+
+    struct Node {
+        enum Kind {EMPTY, CLASS, CONCAT, ALTERNATE, REPEAT, GROUP, BEGIN, END};
+
+        Kind kind = EMPTY;
+        Ranges ranges;
+        std::vector<Node> children;
+        int min = 0;
+        // -1 for no upper bound
+        int max = -1;
+        bool greedy = true;
+        // the capture group's index, -1 for (?:...)
+        int group = -1;
+    };
+
+    // the subset of java's pattern syntax that a DFA can run: no backreferences,
+    // lookaround, word boundaries, possessive quantifiers or inline flags
+    class Parser {
+    public:
+        explicit Parser(const std::string & s) : source(s) {}
+
+        Node parse() {
+            Node n = alternate();
+            if (pos != source.size()) {
+                fail("Unmatched )");
+            }
+            return n;
+        }
+
+        int groups = 0;
+
+    private:
+        [[noreturn]] void fail(const std::string & why) const {
+            throw std::invalid_argument("Invalid regex \"" + source + "\": " + why);
+        }
+
+        bool done() const {
+            return pos >= source.size();
+        }
+
+        bool at(char c) const {
+            return !done() && source[pos] == c;
+        }
+
+        // decodes the code point at pos; a byte that doesn't start valid UTF-8 stands for itself
+        std::uint32_t next() {
+            const auto* p = reinterpret_cast<const unsigned char*>(source.data()) + pos;
+            const std::size_t left = source.size() - pos;
+            const unsigned char c = p[0];
+            std::size_t n = c < 0x80 ? 1 : c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+            if (n > left) {
+                n = 1;
+            }
+            std::uint32_t cp = n == 1 ? c : c & (0xff >> (n + 1));
+            for (std::size_t i = 1; i < n; i++) {
+                cp = (cp << 6) | (p[i] & 0x3f);
+            }
+            pos += n;
+            return cp;
+        }
+
+        static Node literal(std::uint32_t c) {
+            Node n;
+            n.kind = Node::CLASS;
+            n.ranges = {{c, c}};
+            return n;
+        }
+
+        static Node of_kind(Node::Kind kind) {
+            Node n;
+            n.kind = kind;
+            return n;
+        }
+
+        Node alternate() {
+            Node n;
+            n.kind = Node::ALTERNATE;
+            n.children.push_back(concat());
+            while (at('|')) {
+                pos++;
+                n.children.push_back(concat());
+            }
+            return n.children.size() == 1 ? std::move(n.children.front()) : n;
+        }
+
+        Node concat() {
+            Node n;
+            n.kind = Node::CONCAT;
+            while (!done() && !at('|') && !at(')')) {
+                n.children.push_back(repeat());
+            }
+            if (n.children.empty()) {
+                return Node();
+            }
+            return n.children.size() == 1 ? std::move(n.children.front()) : n;
+        }
+
+        int number() {
+            if (done() || source[pos] < '0' || source[pos] > '9') {
+                fail("Expected a number in {}");
+            }
+            long n = 0;
+            while (!done() && source[pos] >= '0' && source[pos] <= '9') {
+                n = std::min<long>(n * 10 + (source[pos++] - '0'), MAX_REPEAT + 1);
+            }
+            return static_cast<int>(n);
+        }
+
+        Node repeat() {
+            Node atom = this->atom();
+            if (done()) {
+                return atom;
+            }
+            int min;
+            int max;
+            switch (source[pos]) {
+                case '*': min = 0; max = -1; pos++; break;
+                case '+': min = 1; max = -1; pos++; break;
+                case '?': min = 0; max = 1; pos++; break;
+                case '{':
+                    pos++;
+                    min = max = number();
+                    if (at(',')) {
+                        pos++;
+                        max = at('}') ? -1 : number();
+                    }
+                    if (!at('}')) {
+                        fail("Unclosed {");
+                    }
+                    pos++;
+                    if (min > MAX_REPEAT || max > MAX_REPEAT) {
+                        fail("Repetition count too large");
+                    }
+                    if (max != -1 && max < min) {
+                        fail("Bad repetition range");
+                    }
+                    break;
+                default:
+                    return atom;
+            }
+            Node n;
+            n.kind = Node::REPEAT;
+            n.min = min;
+            n.max = max;
+            if (at('?')) {
+                pos++;
+                n.greedy = false;
+            } else if (at('+')) {
+                fail("Possessive quantifiers are not supported");
+            }
+            if (!done() && (at('*') || at('+') || at('?') || at('{'))) {
+                fail("Dangling quantifier");
+            }
+            n.children.push_back(std::move(atom));
+            return n;
+        }
+
+        Node atom() {
+            const std::uint32_t c = next();
+            switch (c) {
+                case '(':
+                    {
+                        if (++depth > MAX_NESTING) {
+                            fail("Groups nested too deeply");
+                        }
+                        Node n;
+                        n.kind = Node::GROUP;
+                        if (at('?')) {
+                            pos++;
+                            if (!at(':')) {
+                                fail("Only (?:...) groups are supported");
+                            }
+                            pos++;
+                        } else {
+                            n.group = ++groups;
+                        }
+                        n.children.push_back(alternate());
+                        if (!at(')')) {
+                            fail("Unclosed group");
+                        }
+                        pos++;
+                        depth--;
+                        return n;
+                    }
+                case '*':
+                case '+':
+                case '?':
+                case '{':
+                    fail("Dangling quantifier");
+                case '[':
+                    return char_class();
+                case '.':
+                    {
+                        // any character but a line terminator, as in java
+                        Node n;
+                        n.kind = Node::CLASS;
+                        n.ranges = negate(normalise({{'\n', '\n'}, {'\r', '\r'}, {0x85, 0x85}, {0x2028, 0x2029}}));
+                        return n;
+                    }
+                case '^':
+                    return of_kind(Node::BEGIN);
+                case '$':
+                    return of_kind(Node::END);
+                case '\\':
+                    return escape(false);
+            }
+            return literal(c);
+        }
+
+        static Ranges digit() {
+            return {{'0', '9'}};
+        }
+
+        static Ranges word() {
+            return {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+        }
+
+        static Ranges space() {
+            return {{'\t', '\r'}, {' ', ' '}};
+        }
+
+        std::uint32_t hex(int digits) {
+            std::uint32_t n = 0;
+            for (int i = 0; i < digits; i++) {
+                const char c = done() ? 0 : source[pos++];
+                if (c >= '0' && c <= '9') {
+                    n = n * 16 + (c - '0');
+                } else if (c >= 'a' && c <= 'f') {
+                    n = n * 16 + (c - 'a' + 10);
+                } else if (c >= 'A' && c <= 'F') {
+                    n = n * 16 + (c - 'A' + 10);
+                } else {
+                    fail("Bad hex escape");
+                }
+            }
+            return n;
+        }
+
+        // the escape after a backslash. in a class only escapes that stand for characters
+        // or sets of characters are allowed
+        Node escape(bool in_class) {
+            if (done()) {
+                fail("Trailing backslash");
+            }
+            const std::uint32_t c = next();
+            Node n;
+            n.kind = Node::CLASS;
+            switch (c) {
+                case 'd': n.ranges = digit(); return n;
+                case 'D': n.ranges = negate(digit()); return n;
+                case 'w': n.ranges = word(); return n;
+                case 'W': n.ranges = negate(word()); return n;
+                case 's': n.ranges = space(); return n;
+                case 'S': n.ranges = negate(space()); return n;
+                case 't': return literal('\t');
+                case 'n': return literal('\n');
+                case 'r': return literal('\r');
+                case 'f': return literal('\f');
+                case 'a': return literal('\a');
+                case 'e': return literal(0x1b);
+                case 'x': return literal(hex(2));
+                case 'u': return literal(hex(4));
+                case 'A':
+                case 'z':
+                    if (!in_class) {
+                        return of_kind(c == 'A' ? Node::BEGIN : Node::END);
+                    }
+                    break;
+                default:
+                    if (c < 0x80 && !std::isalnum(static_cast<int>(c))) {
+                        return literal(c);
+                    }
+            }
+            fail("Unsupported escape \\" + std::string(1, static_cast<char>(c)));
+        }
+
+        Node char_class() {
+            Node n;
+            n.kind = Node::CLASS;
+            const bool negated = at('^');
+            if (negated) {
+                pos++;
+            }
+            bool first = true;
+            while (!at(']') || first) {
+                if (done()) {
+                    fail("Unclosed character class");
+                }
+                if (at('[') || (at('&') && pos + 1 < source.size() && source[pos + 1] == '&')) {
+                    fail("Nested classes and intersections are not supported");
+                }
+                first = false;
+                std::uint32_t lo;
+                if (at('\\')) {
+                    pos++;
+                    Node e = escape(true);
+                    if (e.ranges.size() != 1 || e.ranges[0].first != e.ranges[0].second) {
+                        n.ranges.insert(n.ranges.end(), e.ranges.begin(), e.ranges.end());
+                        continue;
+                    }
+                    lo = e.ranges[0].first;
+                } else {
+                    lo = next();
+                }
+                std::uint32_t hi = lo;
+                if (at('-') && pos + 1 < source.size() && source[pos + 1] != ']') {
+                    pos++;
+                    if (at('\\')) {
+                        pos++;
+                        Node e = escape(true);
+                        if (e.ranges.size() != 1 || e.ranges[0].first != e.ranges[0].second) {
+                            fail("Bad class range");
+                        }
+                        hi = e.ranges[0].first;
+                    } else {
+                        hi = next();
+                    }
+                    if (hi < lo) {
+                        fail("Bad class range");
+                    }
+                }
+                n.ranges.emplace_back(lo, hi);
+            }
+            pos++;
+            n.ranges = normalise(n.ranges);
+            if (negated) {
+                n.ranges = negate(n.ranges);
+            }
+            return n;
+        }
+
+        const std::string & source;
+        std::size_t pos = 0;
+        // groups open at pos
+        int depth = 0;
+    };
+
+    // one UTF-8 encoding pattern: the range each byte of a sequence may take
+    using Byte_Ranges = std::vector<std::pair<unsigned char, unsigned char>>;
+
+    inline std::size_t encode(std::uint32_t c, unsigned char* out) {
+        if (c < 0x80) {
+            out[0] = static_cast<unsigned char>(c);
+            return 1;
+        } else if (c < 0x800) {
+            out[0] = static_cast<unsigned char>(0xc0 | (c >> 6));
+            out[1] = static_cast<unsigned char>(0x80 | (c & 0x3f));
+            return 2;
+        } else if (c < 0x10000) {
+            out[0] = static_cast<unsigned char>(0xe0 | (c >> 12));
+            out[1] = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+            out[2] = static_cast<unsigned char>(0x80 | (c & 0x3f));
+            return 3;
+        }
+        out[0] = static_cast<unsigned char>(0xf0 | (c >> 18));
+        out[1] = static_cast<unsigned char>(0x80 | ((c >> 12) & 0x3f));
+        out[2] = static_cast<unsigned char>(0x80 | ((c >> 6) & 0x3f));
+        out[3] = static_cast<unsigned char>(0x80 | (c & 0x3f));
+        return 4;
+    }
+
+    // splits the code points lo to hi into sequences of byte ranges, so that the encodings
+    // of the code points are exactly the byte strings those sequences match
+    inline void utf8_sequences(std::uint32_t lo, std::uint32_t hi, std::vector<Byte_Ranges> & out) {
+        if (lo > hi) {
+            return;
+        }
+        // surrogates have no encoding
+        if (lo <= 0xdfff && hi >= 0xd800) {
+            if (lo < 0xd800) {
+                utf8_sequences(lo, 0xd7ff, out);
+            }
+            if (hi > 0xdfff) {
+                utf8_sequences(0xe000, hi, out);
+            }
+            return;
+        }
+        // ranges that cross an encoding length
+        for (std::uint32_t max : {0x7fu, 0x7ffu, 0xffffu}) {
+            if (lo <= max && hi > max) {
+                utf8_sequences(lo, max, out);
+                utf8_sequences(max + 1, hi, out);
+                return;
+            }
+        }
+        if (hi < 0x80) {
+            out.push_back({{static_cast<unsigned char>(lo), static_cast<unsigned char>(hi)}});
+            return;
+        }
+        // until every byte after the first differing one spans its whole range
+        for (int i = 1; i < 4; i++) {
+            const std::uint32_t m = (1u << (6 * i)) - 1;
+            if ((lo & ~m) != (hi & ~m)) {
+                if ((lo & m) != 0) {
+                    utf8_sequences(lo, lo | m, out);
+                    utf8_sequences((lo | m) + 1, hi, out);
+                    return;
+                }
+                if ((hi & m) != m) {
+                    utf8_sequences(lo, (hi & ~m) - 1, out);
+                    utf8_sequences(hi & ~m, hi, out);
+                    return;
+                }
+            }
+        }
+        unsigned char a[4];
+        unsigned char b[4];
+        const std::size_t n = encode(lo, a);
+        encode(hi, b);
+        Byte_Ranges seq;
+        for (std::size_t i = 0; i < n; i++) {
+            seq.emplace_back(a[i], b[i]);
+        }
+        out.push_back(seq);
+    }
+
+    struct Inst {
+        enum Op {BYTES, SPLIT, JUMP, SAVE, BEGIN, END, MATCH};
+
+        Op op;
+        // the next instruction, or a split's preferred branch
+        int x = -1;
+        // a split's other branch, or the slot a save writes
+        int y = -1;
+        std::bitset<256> bytes;
+    };
+
+    struct Program {
+        std::vector<Inst> insts;
+        int start = -1;
+        int match = -1;
+    };
+
+    // compiles a parsed pattern to a program. nodes are emitted back to front, each given
+    // the instruction that follows it, so nothing needs patching afterwards. a reversed
+    // program matches the reversed bytes of what the forward one matches
+    class Compiler {
+    public:
+        Compiler(Program & p, bool r) : program(p), reversed(r) {}
+
+        int emit(const Node & n, int next) {
+            if (program.insts.size() > MAX_PROGRAM) {
+                throw std::invalid_argument("Invalid regex: pattern too large");
+            }
+            switch (n.kind) {
+                case Node::EMPTY:
+                    return next;
+                case Node::CLASS:
+                    return emit_class(n.ranges, next);
+                case Node::CONCAT:
+                    if (reversed) {
+                        for (const auto & child : n.children) {
+                            next = emit(child, next);
+                        }
+                    } else {
+                        for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) {
+                            next = emit(*it, next);
+                        }
+                    }
+                    return next;
+                case Node::ALTERNATE:
+                    {
+                        std::vector<int> entries;
+                        for (const auto & child : n.children) {
+                            entries.push_back(emit(child, next));
+                        }
+                        int entry = entries.back();
+                        for (auto i = entries.size() - 1; i-- > 0;) {
+                            entry = split(entries[i], entry);
+                        }
+                        return entry;
+                    }
+                case Node::REPEAT:
+                    return emit_repeat(n, next);
+                case Node::GROUP:
+                    if (n.group < 0 || reversed) {
+                        return emit(n.children.front(), next);
+                    } else {
+                        const int close = push(Inst::SAVE, next, 2 * n.group + 1);
+                        const int body = emit(n.children.front(), close);
+                        return push(Inst::SAVE, body, 2 * n.group);
+                    }
+                case Node::BEGIN:
+                    return push(reversed ? Inst::END : Inst::BEGIN, next);
+                case Node::END:
+                    return push(reversed ? Inst::BEGIN : Inst::END, next);
+            }
+            return next;
+        }
+
+        int push(Inst::Op op, int x = -1, int y = -1) {
+            Inst inst;
+            inst.op = op;
+            inst.x = x;
+            inst.y = y;
+            program.insts.push_back(inst);
+            return static_cast<int>(program.insts.size() - 1);
+        }
+
+        int split(int x, int y) {
+            return push(Inst::SPLIT, x, y);
+        }
+
+    private:
+        int bytes(unsigned char lo, unsigned char hi, int next) {
+            const int i = push(Inst::BYTES, next);
+            for (unsigned c = lo; c <= hi; c++) {
+                program.insts[i].bytes.set(c);
+            }
+            return i;
+        }
+
+        int emit_class(const Ranges & ranges, int next) {
+            std::vector<Byte_Ranges> sequences;
+            for (const auto & range : ranges) {
+                utf8_sequences(range.first, range.second, sequences);
+            }
+            if (sequences.empty()) {
+                // an empty class never matches
+                return push(Inst::BYTES, next);
+            }
+            // single bytes all go into one instruction
+            int single = -1;
+            std::vector<int> entries;
+            for (const auto & seq : sequences) {
+                if (seq.size() == 1) {
+                    if (single < 0) {
+                        single = bytes(seq[0].first, seq[0].second, next);
+                        entries.push_back(single);
+                    } else {
+                        for (unsigned c = seq[0].first; c <= seq[0].second; c++) {
+                            program.insts[single].bytes.set(c);
+                        }
+                    }
+                    continue;
+                }
+                int entry = next;
+                if (reversed) {
+                    for (const auto & range : seq) {
+                        entry = bytes(range.first, range.second, entry);
+                    }
+                } else {
+                    for (auto it = seq.rbegin(); it != seq.rend(); ++it) {
+                        entry = bytes(it->first, it->second, entry);
+                    }
+                }
+                entries.push_back(entry);
+            }
+            int entry = entries.back();
+            for (auto i = entries.size() - 1; i-- > 0;) {
+                entry = split(entries[i], entry);
+            }
+            return entry;
+        }
+
+        int emit_repeat(const Node & n, int next) {
+            const Node & child = n.children.front();
+            auto choose = [&](int body, int skip) {
+                return n.greedy ? split(body, skip) : split(skip, body);
+            };
+            int tail = next;
+            int min = n.min;
+            if (n.max < 0) {
+                // x* is compiled as (x+)?, which tests for another iteration after the body
+                // rather than before it. when an iteration matches nothing the thread going
+                // round again dies at the body it already visited, and leaving the loop is
+                // tried next, as a backtracker would. the split has to exist before the body
+                // that jumps back to it
+                const int loop = split(-1, -1);
+                const int body = emit(child, loop);
+                program.insts[loop].x = n.greedy ? body : next;
+                program.insts[loop].y = n.greedy ? next : body;
+                tail = min == 0 ? choose(body, next) : body;
+                min = std::max(min - 1, 0);
+            } else {
+                // x{0,2} is (x(x)?)?
+                for (int i = n.min; i < n.max; i++) {
+                    tail = choose(emit(child, tail), next);
+                }
+            }
+            for (int i = 0; i < min; i++) {
+                tail = emit(child, tail);
+            }
+            return tail;
+        }
+
+        Program & program;
+        bool reversed;
+    };
+
+    struct Key_Hash {
+        std::size_t operator()(const std::vector<int> & v) const {
+            return hash::bytes(v.data(), v.size() * sizeof(int));
+        }
+    };
+
+    // a DFA built from a program as it runs: each state is the ordered list of NFA
+    // instructions that threads are waiting at, and transitions are filled in the first
+    // time they are taken. in leftmost-first mode threads after a match in the list are
+    // dropped, as a backtracker would never try them; in longest mode nothing is dropped
+    // and the last match seen wins. when the cache grows past MAX_STATES it is flushed
+    class Dfa {
+    public:
+        static const std::size_t MAX_STATES = 2048;
+
+        Dfa(const Program & p, int s, bool l) : program(p), start(s), longest(l) {
+            reset();
+        }
+
+        // runs over count bytes from p, stepping by dir. edge_before says whether p is at an end
+        // of the whole text, where BEGIN holds, and edge_after the same for where the run stops,
+        // where END holds. returns how many bytes the preferred match covers, or -1 for none
+        long run(const unsigned char* p, std::size_t count, int dir, bool edge_before, bool edge_after) {
+            std::lock_guard<std::mutex> lock(mutex);
+            int s = starts[edge_before];
+            if (s < 0) {
+                s = starts[edge_before] = intern(closure({start}, edge_before, false));
+                prepare_skip(s);
+            }
+            long last = -1;
+            for (std::size_t i = 0; i < count; i++, p += dir) {
+                if (s == skip) {
+                    // most bytes lead straight back to this state, so they can be passed over
+                    // without looking up transitions
+                    while (i < count && stay[*p]) {
+                        i++;
+                        p += dir;
+                    }
+                    if (i == count) {
+                        break;
+                    }
+                }
+                if (const unsigned char f = flags[s]) {
+                    last = static_cast<long>(i);
+                    if (f & FINAL) {
+                        return last;
+                    }
+                }
+                int n = table[s * 256 + *p];
+                if (n < 0) {
+                    n = step(s, *p);
+                }
+                if (n == DEAD) {
+                    return last;
+                }
+                s = n;
+            }
+            if (ends(s, edge_after, count == 0 && edge_before)) {
+                last = static_cast<long>(count);
+            }
+            return last;
+        }
+
+    private:
+        static const int DEAD = 0;
+        // a thread in the state has matched
+        static const unsigned char MATCH = 1;
+        // and no thread that would be preferred to it is left
+        static const unsigned char FINAL = 2;
+
+        // follows the instructions that consume nothing from pcs, in order
+        std::vector<int> closure(const std::vector<int> & pcs, bool at_begin, bool at_end) {
+            std::vector<int> ret;
+            seen.assign(program.insts.size(), false);
+            std::vector<int> stack(pcs.rbegin(), pcs.rend());
+            while (!stack.empty()) {
+                const int pc = stack.back();
+                stack.pop_back();
+                if (seen[pc]) {
+                    continue;
+                }
+                seen[pc] = true;
+                const Inst & inst = program.insts[pc];
+                switch (inst.op) {
+                    case Inst::BYTES:
+                    case Inst::MATCH:
+                        ret.push_back(pc);
+                        break;
+                    case Inst::SPLIT:
+                        stack.push_back(inst.y);
+                        stack.push_back(inst.x);
+                        break;
+                    case Inst::JUMP:
+                    case Inst::SAVE:
+                        stack.push_back(inst.x);
+                        break;
+                    case Inst::BEGIN:
+                        if (at_begin) {
+                            stack.push_back(inst.x);
+                        }
+                        break;
+                    case Inst::END:
+                        // held until the text ends, when ends() follows it
+                        if (at_end) {
+                            stack.push_back(inst.x);
+                        } else {
+                            ret.push_back(pc);
+                        }
+                        break;
+                }
+            }
+            return ret;
+        }
+
+        bool ends(int s, bool at_end, bool at_begin) {
+            if (flags[s] & MATCH) {
+                return true;
+            }
+            std::vector<int> pending;
+            for (int pc : insts[s]) {
+                if (program.insts[pc].op == Inst::END) {
+                    pending.push_back(program.insts[pc].x);
+                }
+            }
+            if (!at_end || pending.empty()) {
+                return false;
+            }
+            const auto after = closure(pending, at_begin, true);
+            return std::find(after.begin(), after.end(), program.match) != after.end();
+        }
+
+        // an unanchored search spends most of its time in its start state, looping on bytes
+        // that can't begin a match. if s is such a state, builds all its transitions now
+        void prepare_skip(int s) {
+            if (skip >= 0 || flags[s] != 0 || insts.size() + 256 >= MAX_STATES) {
+                return;
+            }
+            int loops = 0;
+            for (int c = 0; c < 256; c++) {
+                int n = table[s * 256 + c];
+                if (n < 0) {
+                    n = step(s, static_cast<unsigned char>(c));
+                }
+                stay[c] = n == s;
+                loops += stay[c];
+            }
+            if (loops >= 128) {
+                skip = s;
+            }
+        }
+
+        int step(int s, unsigned char c) {
+            std::vector<int> targets;
+            for (int pc : insts[s]) {
+                const Inst & inst = program.insts[pc];
+                if (inst.op == Inst::MATCH && !longest) {
+                    break;
+                }
+                if (inst.op == Inst::BYTES && inst.bytes[c]) {
+                    targets.push_back(inst.x);
+                }
+            }
+            auto next = closure(targets, false, false);
+            if (insts.size() >= MAX_STATES) {
+                // keep the state being left, the caller goes on from its index
+                auto current = std::move(insts[s]);
+                reset();
+                s = intern(std::move(current));
+            }
+            const int n = intern(std::move(next));
+            table[s * 256 + c] = n;
+            return n;
+        }
+
+        int intern(std::vector<int> state) {
+            if (longest) {
+                std::sort(state.begin(), state.end());
+            }
+            auto it = index.find(state);
+            if (it != index.end()) {
+                return it->second;
+            }
+            unsigned char f = 0;
+            if (std::find(state.begin(), state.end(), program.match) != state.end()) {
+                f = MATCH;
+                if (!longest && state.front() == program.match) {
+                    f |= FINAL;
+                }
+            }
+            const int i = static_cast<int>(insts.size());
+            flags.push_back(f);
+            table.resize(table.size() + 256, i == DEAD ? DEAD : -1);
+            insts.push_back(state);
+            index.emplace(std::move(state), i);
+            return i;
+        }
+
+        void reset() {
+            insts.clear();
+            flags.clear();
+            table.clear();
+            index.clear();
+            starts = {-1, -1};
+            skip = -1;
+            intern({});
+        }
+
+        const Program & program;
+        const int start;
+        const bool longest;
+        std::mutex mutex;
+        // per state: its instructions, its flags and its 256 transitions, -1 where not yet built
+        std::vector<std::vector<int>> insts;
+        std::vector<unsigned char> flags;
+        std::vector<int> table;
+        std::unordered_map<std::vector<int>, int, Key_Hash> index;
+        std::array<int, 2> starts;
+        // the start state that bytes in stay loop back to, -1 for none
+        int skip = -1;
+        std::array<bool, 256> stay;
+        std::vector<bool> seen;
+    };
+
+    // capture slots: group i spans [slots[2i], slots[2i + 1]), -1 where a group didn't take part
+    using Captures = std::vector<long>;
+
+    // simulates the program anchored at from, keeping every thread in priority order, and
+    // returns the captures of the match a backtracker would have found, or nothing.
+    // threads share capture sets until one of them saves, counted by references.
+    // no byte from end on is read: the DFAs have already found that the match ends there.
+    // n is still the text's length, where $ matches
+    inline Captures pike(const Program & program, int slots, const unsigned char* text, std::size_t n, std::size_t from, std::size_t end) {
+        struct Thread {
+            int pc;
+            int caps;
+        };
+        std::vector<long> pool;
+        std::vector<int> refs;
+        std::vector<int> unused;
+        auto release = [&](int caps) {
+            if (--refs[caps] == 0) {
+                unused.push_back(caps);
+            }
+        };
+        // a set only this thread holds, with slot set to at
+        auto save = [&](int caps, int slot, std::size_t at) {
+            if (refs[caps] > 1) {
+                int copy;
+                if (unused.empty()) {
+                    copy = static_cast<int>(refs.size());
+                    refs.push_back(0);
+                    pool.resize(pool.size() + slots);
+                } else {
+                    copy = unused.back();
+                    unused.pop_back();
+                }
+                std::copy_n(pool.begin() + caps * slots, slots, pool.begin() + copy * slots);
+                refs[copy] = 1;
+                release(caps);
+                caps = copy;
+            }
+            pool[caps * slots + slot] = static_cast<long>(at);
+            return caps;
+        };
+
+        std::vector<Thread> current;
+        std::vector<Thread> following;
+        std::vector<Thread> stack;
+        std::vector<std::size_t> seen(program.insts.size(), 0);
+        std::size_t generation = 0;
+        Captures matched;
+
+        auto add = [&](std::vector<Thread> & list, int first, int caps, std::size_t at) {
+            stack.push_back(Thread{first, caps});
+            while (!stack.empty()) {
+                Thread t = stack.back();
+                stack.pop_back();
+                if (seen[t.pc] == generation) {
+                    release(t.caps);
+                    continue;
+                }
+                seen[t.pc] = generation;
+                const Inst & inst = program.insts[t.pc];
+                switch (inst.op) {
+                    case Inst::BYTES:
+                    case Inst::MATCH:
+                        list.push_back(t);
+                        break;
+                    case Inst::SPLIT:
+                        refs[t.caps]++;
+                        stack.push_back(Thread{inst.y, t.caps});
+                        stack.push_back(Thread{inst.x, t.caps});
+                        break;
+                    case Inst::JUMP:
+                        stack.push_back(Thread{inst.x, t.caps});
+                        break;
+                    case Inst::SAVE:
+                        stack.push_back(Thread{inst.x, save(t.caps, inst.y, at)});
+                        break;
+                    case Inst::BEGIN:
+                    case Inst::END:
+                        if (inst.op == Inst::BEGIN ? at == 0 : at == n) {
+                            stack.push_back(Thread{inst.x, t.caps});
+                        } else {
+                            release(t.caps);
+                        }
+                        break;
+                }
+            }
+        };
+
+        generation++;
+        pool.assign(slots, -1);
+        refs.push_back(1);
+        add(current, program.start, 0, from);
+        for (std::size_t at = from; !current.empty(); at++) {
+            generation++;
+            for (std::size_t i = 0; i < current.size(); i++) {
+                const Thread & t = current[i];
+                const Inst & inst = program.insts[t.pc];
+                if (inst.op == Inst::MATCH) {
+                    // threads after this one are less preferred
+                    matched.assign(pool.begin() + t.caps * slots, pool.begin() + (t.caps + 1) * slots);
+                    for (; i < current.size(); i++) {
+                        release(current[i].caps);
+                    }
+                    break;
+                }
+                if (at < end && inst.bytes[text[at]]) {
+                    add(following, inst.x, t.caps, at + 1);
+                } else {
+                    release(t.caps);
+                }
+            }
+            if (at >= end) {
+                break;
+            }
+            current.swap(following);
+            following.clear();
+        }
+        return matched;
+    }
+
+    class Regex {
+    public:
+        explicit Regex(const std::string & s) : source(s) {
+            Parser parser(s);
+            const Node root = parser.parse();
+            groups = parser.groups;
+
+            // forward runs the pattern as group 0, after (?s:.)*? for unanchored searches.
+            // exact shares its instructions and also requires the text to end
+            Node whole;
+            whole.kind = Node::GROUP;
+            whole.group = 0;
+            whole.children.push_back(root);
+            {
+                Compiler c(forward, false);
+                forward.match = c.push(Inst::MATCH);
+                exact.start = c.emit(whole, c.push(Inst::END, forward.match));
+                forward.start = c.emit(whole, forward.match);
+                unanchored_start = c.split(forward.start, -1);
+                forward.insts[unanchored_start].y = c.push(Inst::BYTES, unanchored_start);
+                forward.insts.back().bytes.set();
+            }
+            exact.insts = forward.insts;
+            exact.match = forward.match;
+            {
+                Compiler c(backward, true);
+                backward.match = c.push(Inst::MATCH);
+                backward.start = c.emit(root, backward.match);
+            }
+
+            search = std::make_unique<Dfa>(forward, unanchored_start, false);
+            reverse = std::make_unique<Dfa>(backward, backward.start, true);
+            whole_match = std::make_unique<Dfa>(exact, exact.start, true);
+        }
+
+        const std::string source;
+        int groups = 0;
+
+        // the first match starting at or after from, or nothing
+        Captures find(const std::string & text, std::size_t from) const {
+            const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+            const std::size_t n = text.size();
+            const long length = search->run(p + from, n - from, 1, from == 0, true);
+            if (length < 0) {
+                return {};
+            }
+            const std::size_t end = from + length;
+            // scans back from the match's last byte to the latest start of a match that ends there
+            const long back = end > from ? reverse->run(p + end - 1, end - from, -1, end == n, from == 0) : 0;
+            const std::size_t begin = end - std::max(back, 0L);
+            if (groups == 0) {
+                return {static_cast<long>(begin), static_cast<long>(end)};
+            }
+            return pike(forward, 2 * groups + 2, p, n, begin, end);
+        }
+
+        // a match of the whole text, or nothing
+        Captures matches(const std::string & text) const {
+            const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+            if (whole_match->run(p, text.size(), 1, true, true) != static_cast<long>(text.size())) {
+                return {};
+            }
+            if (groups == 0) {
+                return {0, static_cast<long>(text.size())};
+            }
+            return pike(exact, 2 * groups + 2, p, text.size(), 0, text.size());
+        }
+
+    private:
+        Program forward;
+        Program backward;
+        Program exact;
+        int unanchored_start = -1;
+        std::unique_ptr<Dfa> search;
+        std::unique_ptr<Dfa> reverse;
+        std::unique_ptr<Dfa> whole_match;
+    };
+
+    // patterns by source, so a pattern written inline in a loop is only compiled once
+    inline std::shared_ptr<const Regex> compile(const std::string & source) {
+        static const std::size_t MAX_CACHED = 1024;
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const Regex>, hash::String_Hash> cache;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = cache.find(source);
+            if (it != cache.end()) {
+                return it->second;
+            }
+        }
+        auto regex = std::make_shared<const Regex>(source);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= MAX_CACHED) {
+            cache.clear();
+        }
+        return cache.emplace(source, regex).first->second;
+    }
+
+    }
+
+}
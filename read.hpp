@@ -1,13 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <list>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <variant>
+#include <optional>
+#include <algorithm>
 #include <regex>
 
+#include "hash.hpp"
+#include "text.hpp"
+
 namespace zachlisp {
 
     // zachlisp::token
@@ -39,11 +46,23 @@ namespace zachlisp {
         "([^\\s\\[\\]{}(\'\"`,;)]+)"   // type::SYMBOL
     );
 
+    // storage for an evaluator's inline cache at one place in the source.
+    // copies of a token share it, so it survives the evaluator copying forms
+    struct Site_Cache {
+        std::atomic<std::size_t> slot{0};
+        // whatever the evaluator prepared from the list this token heads,
+        // read and written with std::atomic_load and std::atomic_store
+        std::shared_ptr<const void> compiled;
+    };
+
     struct Token {
         value::Value value;
         type::Type type;
         int line;
         int column;
+        // set for keywords, which the evaluator can call to look up record fields,
+        // and for symbols at the head of a list
+        std::shared_ptr<Site_Cache> cache;
 
         Token(value::Value v, type::Type t, int l, int c) : value(v), type(t), line(l), column(c) {}
 
@@ -75,6 +94,8 @@ namespace zachlisp {
 
     using FormWrapperMap = std::unordered_map<FormWrapper, FormWrapper, FormWrapperHash, FormWrapperEquality>;
     using FormWrapperSet = std::unordered_set<FormWrapper, FormWrapperHash, FormWrapperEquality>;
+    struct SortedFormMap;
+    struct SortedFormSet;
 
     using Form = std::variant<
         Special,
@@ -86,40 +107,50 @@ namespace zachlisp {
         // their content needs to be hashable
         // and that isn't implemented until later...
         std::shared_ptr<FormWrapperMap>,
-        std::shared_ptr<FormWrapperSet>
+        std::shared_ptr<FormWrapperSet>,
+        // sorted maps and sets only come from evaluating, never from the reader
+        std::shared_ptr<SortedFormMap>,
+        std::shared_ptr<SortedFormSet>
     >;
 
-    enum Type {SPECIAL, TOKEN, LIST, VECTOR, MAP, SET};
+    enum Type {SPECIAL, TOKEN, LIST, VECTOR, MAP, SET, SORTED_MAP, SORTED_SET};
 
     std::size_t hash(const FormWrapper & fw);
     bool equals(const FormWrapper & fw1, const FormWrapper & fw2);
 
     }
 
-// see: https://stackoverflow.com/a/38140932
-
-inline void hash_combine(std::size_t& seed) { }
-
-template <typename T, typename... Rest>
-inline void hash_combine(std::size_t& seed, const T& v, Rest... rest) {
-    std::hash<T> hasher;
-    seed ^= hasher(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
-    hash_combine(seed, rest...);
-}
-
 }
 
 namespace std {
 
 template <> struct hash<zachlisp::token::Token> {
     size_t operator()(const zachlisp::token::Token & x) const {
-        return std::hash<zachlisp::token::value::Value>()(x.value);
+        namespace value = zachlisp::token::value;
+        std::size_t h;
+        switch (x.value.index()) {
+            case value::BOOL:
+                h = zachlisp::hash::integer(std::get<bool>(x.value));
+                break;
+            case value::CHAR:
+                h = zachlisp::hash::integer(static_cast<unsigned char>(std::get<char>(x.value)));
+                break;
+            case value::LONG:
+                h = zachlisp::hash::integer(std::get<long>(x.value));
+                break;
+            case value::DOUBLE:
+                h = zachlisp::hash::floating(std::get<double>(x.value));
+                break;
+            default:
+                h = zachlisp::hash::string(std::get<std::string>(x.value));
+        }
+        return zachlisp::hash::combine(h, x.type);
     }
 };
 
 template <> struct hash<zachlisp::form::Special> {
     size_t operator()(const zachlisp::form::Special & x) const {
-        return std::hash<std::string>()(x.message);
+        return zachlisp::hash::string(x.message);
     }
 };
 
@@ -173,6 +204,9 @@ namespace zachlisp {
                    value::Value value = parse(value_str, type);
                    int column = match.position() + 1;
                    tokens.push_back(Token{value, type, line, column});
+                   if (type == type::SYMBOL && value_str.size() > 1 && value_str[0] == ':') {
+                       tokens.back().cache = std::make_shared<Site_Cache>();
+                   }
                    line += std::count(value_str.begin(), value_str.end(), '\n');
                    break;
                }
@@ -210,46 +244,55 @@ namespace zachlisp {
             return equals(fw1, fw2);
         }
     };
+
+    // the entries of a sorted map or set in key order, which is the order they print in.
+    // they are equal to, and hash the same as, a hashed map or set with the same entries
+    struct SortedFormMap {
+        std::vector<std::pair<FormWrapper, FormWrapper>> entries;
+    };
+
+    struct SortedFormSet {
+        std::vector<FormWrapper> items;
+    };
     
     template <class T>
-    std::size_t hash(T list) {
-        std::size_t ret = 0;
-        for (auto item : list) {
-            hash_combine(ret, item);
+    std::size_t hash(const T & list) {
+        std::size_t ret = hash::integer(list.size());
+        for (const auto & item : list) {
+            ret = hash::combine(ret, hash(item));
         }
         return ret;
     }
 
-    std::size_t hash(FormWrapperSet set) {
-        std::vector<std::size_t> hashes;
-        for (auto item : set) {
-            hashes.push_back(hash(item));
-        }
-
+    // sets and maps hash their entries' hashes in sorted order, so iteration order doesn't matter
+    std::size_t hash_unordered(std::vector<std::size_t> hashes) {
         std::sort(hashes.begin(), hashes.end());
 
-        std::size_t ret = 0;
-        for (auto hash : hashes) {
-            hash_combine(ret, hash);
+        std::size_t ret = hash::integer(hashes.size());
+        for (auto h : hashes) {
+            ret = hash::combine(ret, h);
         }
         return ret;
     }
 
-    std::size_t hash(FormWrapperMap map) {
+    template <class T>
+    std::size_t hash_set(const T & set) {
         std::vector<std::size_t> hashes;
-        for (auto item : map) {
-            std::size_t hash = 0;
-            hash_combine(hash, item.first, item.second);
-            hashes.push_back(hash);
+        hashes.reserve(set.size());
+        for (const auto & item : set) {
+            hashes.push_back(hash(item));
         }
+        return hash_unordered(std::move(hashes));
+    }
 
-        std::sort(hashes.begin(), hashes.end());
-
-        std::size_t ret = 0;
-        for (auto hash : hashes) {
-            hash_combine(ret, hash);
+    template <class T>
+    std::size_t hash_map(const T & map) {
+        std::vector<std::size_t> hashes;
+        hashes.reserve(map.size());
+        for (const auto & item : map) {
+            hashes.push_back(hash::combine(hash(item.first), hash(item.second)));
         }
-        return ret;
+        return hash_unordered(std::move(hashes));
     }
 
     std::size_t hash(const FormWrapper & fw) {
@@ -263,16 +306,110 @@ namespace zachlisp {
             case VECTOR:
                 return hash<std::vector<FormWrapper>>(std::get<std::vector<FormWrapper>>(fw.form));
             case MAP:
-                return hash(*std::get<std::shared_ptr<FormWrapperMap>>(fw.form));
+                return hash_map(*std::get<std::shared_ptr<FormWrapperMap>>(fw.form));
             case SET:
-                return hash(*std::get<std::shared_ptr<FormWrapperSet>>(fw.form));
+                return hash_set(*std::get<std::shared_ptr<FormWrapperSet>>(fw.form));
+            case SORTED_MAP:
+                return hash_map(std::get<std::shared_ptr<SortedFormMap>>(fw.form)->entries);
+            case SORTED_SET:
+                return hash_set(std::get<std::shared_ptr<SortedFormSet>>(fw.form)->items);
         }
         return 0;
     }
 
+    template <class T>
+    bool equals(const T & list1, const T & list2) {
+        return list1.size() == list2.size() && std::equal(list1.begin(), list1.end(), list2.begin(), [](const FormWrapper & a, const FormWrapper & b) {
+            return equals(a, b);
+        });
+    }
+
+    // the value of key in a hashed or sorted map form, or nullptr
+    const FormWrapper* map_find(const Form & map, const FormWrapper & key) {
+        if (map.index() == MAP) {
+            const auto & m = *std::get<std::shared_ptr<FormWrapperMap>>(map);
+            const auto it = m.find(key);
+            return it != m.end() ? &it->second : nullptr;
+        }
+        for (const auto & entry : std::get<std::shared_ptr<SortedFormMap>>(map)->entries) {
+            if (equals(entry.first, key)) {
+                return &entry.second;
+            }
+        }
+        return nullptr;
+    }
+
+    bool set_contains(const Form & set, const FormWrapper & item) {
+        if (set.index() == SET) {
+            return std::get<std::shared_ptr<FormWrapperSet>>(set)->count(item) > 0;
+        }
+        const auto & items = std::get<std::shared_ptr<SortedFormSet>>(set)->items;
+        return std::any_of(items.begin(), items.end(), [&](const FormWrapper & i) { return equals(i, item); });
+    }
+
+    // every entry of map1 is in map2 with an equal value, and they are the same size
+    template <class T>
+    bool same_entries(const T & map1, const Form & map2, std::size_t size2) {
+        return map1.size() == size2 && std::all_of(map1.begin(), map1.end(), [&](const auto & e) {
+            const auto value = map_find(map2, e.first);
+            return value && equals(e.second, *value);
+        });
+    }
+
+    template <class T>
+    bool same_items(const T & set1, const Form & set2, std::size_t size2) {
+        return set1.size() == size2 && std::all_of(set1.begin(), set1.end(), [&](const FormWrapper & item) {
+            return set_contains(set2, item);
+        });
+    }
+
+    // compares structure rather than hashes, so keys whose hashes collide stay distinct.
+    // a sorted map or set equals a hashed one with the same entries, as in clojure
     bool equals(const FormWrapper & fw1, const FormWrapper & fw2) {
-        // TODO: equality checking probably shouldn't rely on hashes
-        return hash(fw1) == hash(fw2);
+        const auto kind = [](const Form & form) -> std::size_t {
+            switch (form.index()) {
+                case SORTED_MAP:
+                    return MAP;
+                case SORTED_SET:
+                    return SET;
+            }
+            return form.index();
+        };
+        if (kind(fw1.form) != kind(fw2.form)) {
+            return false;
+        }
+        const auto size = [](const Form & form) -> std::size_t {
+            switch (form.index()) {
+                case MAP:
+                    return std::get<std::shared_ptr<FormWrapperMap>>(form)->size();
+                case SET:
+                    return std::get<std::shared_ptr<FormWrapperSet>>(form)->size();
+                case SORTED_MAP:
+                    return std::get<std::shared_ptr<SortedFormMap>>(form)->entries.size();
+                case SORTED_SET:
+                    return std::get<std::shared_ptr<SortedFormSet>>(form)->items.size();
+            }
+            return 0;
+        };
+        switch (fw1.form.index()) {
+            case SPECIAL:
+                return std::get<form::Special>(fw1.form) == std::get<form::Special>(fw2.form);
+            case TOKEN:
+                return std::get<token::Token>(fw1.form) == std::get<token::Token>(fw2.form);
+            case LIST:
+                return equals(std::get<std::list<FormWrapper>>(fw1.form), std::get<std::list<FormWrapper>>(fw2.form));
+            case VECTOR:
+                return equals(std::get<std::vector<FormWrapper>>(fw1.form), std::get<std::vector<FormWrapper>>(fw2.form));
+            case MAP:
+                return same_entries(*std::get<std::shared_ptr<FormWrapperMap>>(fw1.form), fw2.form, size(fw2.form));
+            case SET:
+                return same_items(*std::get<std::shared_ptr<FormWrapperSet>>(fw1.form), fw2.form, size(fw2.form));
+            case SORTED_MAP:
+                return same_entries(std::get<std::shared_ptr<SortedFormMap>>(fw1.form)->entries, fw2.form, size(fw2.form));
+            case SORTED_SET:
+                return same_items(std::get<std::shared_ptr<SortedFormSet>>(fw1.form)->items, fw2.form, size(fw2.form));
+        }
+        return false;
     }
 
     }
@@ -368,6 +505,12 @@ std::pair<form::Form, std::list<token::Token>::const_iterator> read_coll(const s
             }
         }
         auto ret2 = read_form(tokens, it);
+        if (form_type == form::LIST && forms.empty() && ret2.first.index() == form::TOKEN) {
+            auto & head = std::get<token::Token>(ret2.first);
+            if (head.type == token::type::SYMBOL && !head.cache) {
+                head.cache = std::make_shared<token::Site_Cache>();
+            }
+        }
         forms.push_back(form::FormWrapper{ret2.first});
         it = ret2.second;
     }
@@ -377,6 +520,8 @@ std::pair<form::Form, std::list<token::Token>::const_iterator> read_coll(const s
 std::pair<form::Form, std::list<token::Token>::const_iterator> expand_quoted_form(const std::list<token::Token> *tokens, std::list<token::Token>::const_iterator it, token::Token token) {
     if (auto ret_opt = read_useful_form(tokens, it)) {
         auto ret = ret_opt.value();
+        // the expansion is a list like any other, so its head gets a cache too
+        token.cache = std::make_shared<token::Site_Cache>();
         std::list<form::FormWrapper> list {
             form::FormWrapper{token},
             ret.first
@@ -443,12 +588,21 @@ std::pair<form::Form, std::list<token::Token>::const_iterator> read_form(const s
             }
         case token::type::STRING:
             {
-                std::string s = std::get<std::string>(token.value);
+                const auto & s = std::get<std::string>(token.value);
                 if (s.size() < 2 || s.back() != '"') {
                     return std::make_pair(form::Special{"ReaderError", "EOF: unbalanced quote", token}, tokens->end());
-                } else {
-                    token.value = s.substr(1, s.size() - 2);
                 }
+                std::string decoded;
+                std::string error;
+                switch (text::unescape(s.data() + 1, s.data() + s.size() - 1, decoded, error)) {
+                    case text::Status::OK:
+                        break;
+                    case text::Status::UNTERMINATED:
+                        return std::make_pair(form::Special{"ReaderError", "EOF: unbalanced quote", token}, tokens->end());
+                    case text::Status::INVALID:
+                        return std::make_pair(form::Special{"ReaderError", error, token}, tokens->end());
+                }
+                token.value = std::move(decoded);
                 break;
             }
     }
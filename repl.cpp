@@ -1,17 +1,96 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "read.hpp"
 #include "eval.hpp"
 #include "print.hpp"
+#include "metrics.hpp"
+#include "core.hpp"
+
+// reads a positive whole number from the environment variable name, leaving value alone
+// if it is unset. false if it is set to anything else: stoull would throw on some of
+// those and wrap "-1" around on others
+bool env_count(const char* name, unsigned long long & value) {
+    const char* text = std::getenv(name);
+    if (text == nullptr) {
+        return true;
+    }
+    char* end;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    if (!std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || errno != 0 || value == 0) {
+        std::cerr << name << " must be a positive whole number, not \"" << text << "\"\n";
+        return false;
+    }
+    return true;
+}
+
+void usage() {
+    std::cerr << "environment:\n"
+              << "  ZACHLISP_MEMORY_LIMIT=bytes    cap on the memory scripts may allocate\n"
+              << "  ZACHLISP_ALLOC_PROFILE=bytes   sample an allocation every this many bytes\n"
+              << "  ZACHLISP_METRICS_INTERVAL=secs how often ZACHLISP_METRICS_FILE is written, 10 by default\n";
+}
 
 int main(int argc, char* argv[]) {
     chaiscript::ChaiScript chai;
+    // maps built in C++ key their entries the way a map literal would
+    zachlisp::core::install(chai, [&chai](const chaiscript::Boxed_Value & key) {
+        return zachlisp::pr_str(zachlisp::chai_to_form(key, &chai));
+    });
+    unsigned long long limit = 0;
+    if (!env_count("ZACHLISP_MEMORY_LIMIT", limit)) {
+        usage();
+        return 1;
+    }
+    if (limit != 0) {
+        chai.set_memory_limit(limit);
+    }
+    unsigned long long sample_interval = 0;
+    if (!env_count("ZACHLISP_ALLOC_PROFILE", sample_interval)) {
+        usage();
+        return 1;
+    }
+    if (sample_interval != 0) {
+        const char* folded = std::getenv("ZACHLISP_ALLOC_PROFILE_FOLDED");
+        zachlisp::profile::start(sample_interval, folded ? folded : "");
+    }
+    // 0 would have the exporter write in a busy loop
+    unsigned long long metrics_interval = 10;
+    if (!env_count("ZACHLISP_METRICS_INTERVAL", metrics_interval)) {
+        usage();
+        return 1;
+    }
+    std::unique_ptr<zachlisp::metrics::Exporter> exporter;
+    if (const char* path = std::getenv("ZACHLISP_METRICS_FILE")) {
+        exporter = std::make_unique<zachlisp::metrics::Exporter>(path, std::chrono::seconds(metrics_interval));
+    }
+    auto & metrics = zachlisp::metrics::local();
     std::string input;
     do {
         std::cout << "user> ";
         std::getline(std::cin, input);
-        std::cout << zachlisp::print(zachlisp::eval(zachlisp::read(input), &chai));
+        std::list<zachlisp::form::Form> forms;
+        {
+            const zachlisp::metrics::Timer timer(metrics.read);
+            forms = zachlisp::read(input);
+        }
+        for (const auto & form : forms) {
+            std::list<zachlisp::form::Form> result;
+            {
+                const zachlisp::metrics::Eval_Timer timer(form);
+                result = zachlisp::eval({form}, &chai);
+            }
+            const zachlisp::metrics::Timer timer(metrics.print[form.index()]);
+            std::cout << zachlisp::print(result);
+        }
     } while (!std::cin.fail());
+    if (zachlisp::profile::enabled()) {
+        zachlisp::profile::dump(std::cerr);
+    }
     return 0;
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace zachlisp {
+
+    // zachlisp::sort
+    // stable sorts over keys that were extracted into a typed array ahead of time, each
+    // paired with the index of the item it came from, so comparing two keys never goes
+    // through chai's dispatch
+    namespace sort {
+
+    template <class K>
+    using Keyed = std::pair<K, std::size_t>;
+
+    // LSD radix sort, one byte per pass. passes where every key has the same byte are skipped,
+    // so small keys take few passes
+    inline void radix_sort(std::vector<Keyed<std::int64_t>> & v) {
+        // flipping the sign bit orders negative keys before positive ones
+        auto bits = [](std::int64_t key) { return static_cast<std::uint64_t>(key) ^ (std::uint64_t(1) << 63); };
+        std::vector<Keyed<std::int64_t>> buffer(v.size());
+        for (int shift = 0; shift < 64; shift += 8) {
+            std::array<std::size_t, 257> starts{};
+            for (const auto & e : v) {
+                starts[((bits(e.first) >> shift) & 0xff) + 1]++;
+            }
+            if (std::find(starts.begin() + 1, starts.end(), v.size()) != starts.end()) {
+                continue;
+            }
+            for (std::size_t i = 1; i < starts.size(); i++) {
+                starts[i] += starts[i - 1];
+            }
+            for (const auto & e : v) {
+                buffer[starts[(bits(e.first) >> shift) & 0xff]++] = e;
+            }
+            v.swap(buffer);
+        }
+    }
+
+    // stable merge sort: the array is cut into one run per hardware thread, the runs are
+    // sorted concurrently and then merged pairwise, each round of merges also concurrently.
+    // arrays shorter than two runs of min_run are sorted on the calling thread
+    template <class T, class Less>
+    void parallel_sort(std::vector<T> & v, Less less, std::size_t min_run = std::size_t(1) << 14) {
+        const std::size_t runs = parallel::pieces(v.size(), min_run);
+        if (runs <= 1) {
+            std::stable_sort(v.begin(), v.end(), less);
+            return;
+        }
+
+        std::vector<std::size_t> bounds;
+        for (std::size_t i = 0; i <= runs; i++) {
+            bounds.push_back(v.size() * i / runs);
+        }
+        parallel::run_all(runs, [&](std::size_t i) {
+            std::stable_sort(v.begin() + bounds[i], v.begin() + bounds[i + 1], less);
+        });
+
+        while (bounds.size() > 2) {
+            parallel::run_all((bounds.size() - 1) / 2, [&](std::size_t i) {
+                std::inplace_merge(v.begin() + bounds[2 * i], v.begin() + bounds[2 * i + 1], v.begin() + bounds[2 * i + 2], less);
+            });
+            std::vector<std::size_t> merged;
+            for (std::size_t i = 0; i < bounds.size(); i += 2) {
+                merged.push_back(bounds[i]);
+            }
+            if (merged.back() != bounds.back()) {
+                merged.push_back(bounds.back());
+            }
+            bounds.swap(merged);
+        }
+    }
+
+    }
+
+}
@@ -1,4 +1,11 @@
 #!/bin/bash
 EXEC=zachlisp
 STEP=${1:-step2_eval}
-./tests/runtest.py tests/$STEP.mal -- ./$EXEC
+if [ -f tests/$STEP.cpp ]; then
+    # a C++ test of a header, built on its own
+    g++ tests/$STEP.cpp -O1 -lpthread -o test_$STEP -std=c++17 && ./test_$STEP
+else
+    # a .mal test can ask for environment variables on a first line like ";; env: NAME=value"
+    ENV=$(sed -n '1s/^;; env: //p' tests/$STEP.mal)
+    env $ENV ./tests/runtest.py tests/$STEP.mal -- ./$EXEC
+fi
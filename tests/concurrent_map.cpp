@@ -0,0 +1,172 @@
+// tests for chaiscript::Concurrent_Map, on one thread and on several, including that
+// every node and table retired through the epochs is freed. run with ./tests.sh concurrent_map
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../chaiscript/dispatchkit/concurrent_map.hpp"
+
+int failures = 0;
+
+void check(bool ok, const std::string & what) {
+    if (!ok) {
+        std::cout << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+// a value that counts how many copies of it are alive, so the test can tell whether
+// retired nodes were freed
+struct Counted {
+    static std::atomic<long> live;
+
+    long n = 0;
+
+    Counted() {
+        live++;
+    }
+    Counted(long v) : n(v) {
+        live++;
+    }
+    Counted(const Counted & c) : n(c.n) {
+        live++;
+    }
+    Counted & operator=(const Counted &) = default;
+    ~Counted() {
+        live--;
+    }
+};
+
+std::atomic<long> Counted::live{0};
+
+using Map = chaiscript::Concurrent_Map<std::string, Counted>;
+
+// frees whatever has been retired and is no longer reachable; two advances of the epoch
+// past a retirement are enough when no thread is reading
+void drain() {
+    for (int i = 0; i < 4; i++) {
+        chaiscript::detail::Epoch::reclaim();
+    }
+}
+
+void single_thread() {
+    Map map;
+    Counted value;
+    check(map.empty(), "a new map is empty");
+    check(!map.find("a", value), "a new map finds nothing");
+
+    map.insert_or_assign("a", Counted(1));
+    check(map.find("a", value) && value.n == 1, "find returns what was inserted");
+    map.insert_or_assign("a", Counted(2));
+    check(map.find("a", value) && value.n == 2 && map.size() == 1, "insert_or_assign replaces");
+
+    check(map.update("a", [](const Counted & c) { return Counted(c.n + 10); }).n == 12, "update returns the new value");
+    check(map.update("b", [](const Counted & c) { return Counted(c.n + 1); }).n == 1, "update starts from a default value");
+
+    int calls = 0;
+    auto make = [&calls](const std::string &) { calls++; return Counted(7); };
+    check(map.compute_if_absent("c", make).n == 7, "compute_if_absent adds a missing key");
+    check(map.compute_if_absent("c", make).n == 7 && calls == 1, "compute_if_absent calls once per key");
+
+    check(map.erase("b") == 1 && map.erase("b") == 0 && !map.contains("b"), "erase removes a key once");
+    check(map.size() == 2, "size counts the keys left");
+
+    // enough keys for the table to grow several times
+    for (long i = 0; i < 5000; i++) {
+        map.insert_or_assign(std::to_string(i), Counted(i));
+    }
+    bool all = true;
+    for (long i = 0; i < 5000; i++) {
+        all = all && map.find(std::to_string(i), value) && value.n == i;
+    }
+    check(all && map.size() == 5002, "every key survives the table growing");
+
+    const auto snapshot = map.snapshot();
+    check(snapshot.size() == 5002 && snapshot.at("a").n == 12, "snapshot copies every entry");
+}
+
+void many_threads() {
+    const int threads = 8;
+    const long keys = 1000;
+    const long rounds = 20000;
+    Map map;
+
+    // every thread adds one to each key rounds / keys times
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&map, t] {
+            for (long i = 0; i < rounds; i++) {
+                map.update(std::to_string((i + t * 37) % keys), [](const Counted & c) { return Counted(c.n + 1); });
+            }
+        });
+    }
+    for (auto & w : workers) {
+        w.join();
+    }
+    bool all = true;
+    Counted value;
+    for (long k = 0; k < keys; k++) {
+        all = all && map.find(std::to_string(k), value) && value.n == threads * rounds / keys;
+    }
+    check(all && map.size() == static_cast<std::size_t>(keys), "no update is lost between threads");
+
+    // readers walk chains while writers replace and erase their nodes
+    for (long k = 0; k < keys; k++) {
+        map.insert_or_assign(std::to_string(k), Counted(0));
+    }
+    std::atomic<bool> stop{false};
+    std::atomic<long> torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads / 2; t++) {
+        readers.emplace_back([&] {
+            Counted v;
+            while (!stop) {
+                for (long k = 0; k < keys; k++) {
+                    // values are only ever set to multiples of 3
+                    if (map.find(std::to_string(k), v) && v.n % 3 != 0) {
+                        torn++;
+                    }
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads / 2; t++) {
+        writers.emplace_back([&map, t] {
+            for (long i = 0; i < rounds; i++) {
+                const auto key = std::to_string((i * 7 + t) % keys);
+                if (i % 4 == 0) {
+                    map.erase(key);
+                } else {
+                    map.insert_or_assign(key, Counted(i * 3));
+                }
+            }
+        });
+    }
+    for (auto & w : writers) {
+        w.join();
+    }
+    stop = true;
+    for (auto & r : readers) {
+        r.join();
+    }
+    check(torn == 0, "readers only see whole values");
+}
+
+int main() {
+    single_thread();
+    drain();
+    check(Counted::live == 0, "a single-threaded map frees every value");
+
+    many_threads();
+    drain();
+    check(Counted::live == 0, "values retired while threads read are all freed");
+
+    if (failures == 0) {
+        std::cout << "concurrent_map: all tests passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
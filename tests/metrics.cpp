@@ -0,0 +1,131 @@
+// tests for zachlisp::metrics: histogram buckets and quantiles, merging the threads'
+// metrics, and the Prometheus text the exporter writes. run with ./tests.sh metrics
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../metrics.hpp"
+
+namespace metrics = zachlisp::metrics;
+
+int failures = 0;
+
+void check(bool ok, const std::string & what) {
+    if (!ok) {
+        std::cout << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+bool contains(const std::string & text, const std::string & line) {
+    return text.find(line + "\n") != std::string::npos;
+}
+
+void buckets() {
+    bool exact = true;
+    for (std::uint64_t v = 0; v < metrics::SUB_BUCKETS; v++) {
+        exact = exact && metrics::bucket(v) == v && metrics::bucket_max(v) == v;
+    }
+    check(exact, "small values have a bucket each");
+
+    bool close = true;
+    bool ordered = true;
+    for (std::uint64_t v = metrics::SUB_BUCKETS; v < (std::uint64_t(1) << 36); v += v / 7 + 1) {
+        const auto i = metrics::bucket(v);
+        const auto max = metrics::bucket_max(i);
+        close = close && max >= v && max - v <= v / metrics::SUB_BUCKETS;
+        ordered = ordered && (i == 0 || metrics::bucket_max(i - 1) < v);
+    }
+    check(close, "a bucket's largest value is within 1/32 of every value in it");
+    check(ordered, "each value lands in the first bucket that can hold it");
+    check(metrics::bucket(~std::uint64_t(0)) == metrics::BUCKETS - 1, "huge values share the last bucket");
+}
+
+void quantiles() {
+    metrics::Histogram h;
+    for (std::uint64_t v = 1; v <= 1000; v++) {
+        h.record(v * 1000);
+    }
+    metrics::Histogram_Snapshot s;
+    s.merge(h);
+    check(s.count == 1000 && s.sum == 500500000, "a snapshot counts and sums what was recorded");
+    auto near = [](std::uint64_t got, std::uint64_t want) { return got >= want && got - want <= want / 16; };
+    check(near(s.quantile(0.5), 501000), "the median is within the bucket error");
+    check(near(s.quantile(0.99), 991000), "the 99th percentile is within the bucket error");
+    check(metrics::Histogram_Snapshot().quantile(0.5) == 0, "an empty histogram's quantiles are 0");
+
+    metrics::Histogram_Snapshot twice;
+    twice.merge(s);
+    twice.merge(s);
+    check(twice.count == 2000 && twice.quantile(0.5) == s.quantile(0.5), "merging snapshots adds their counts");
+}
+
+void threads() {
+    const auto before = metrics::snapshot();
+    metrics::local().errors.add(1);
+    metrics::site_cache(true);
+    std::thread([] {
+        metrics::local().errors.add(2);
+        metrics::local().read.record(5);
+        metrics::site_cache(false);
+    }).join();
+    const auto after = metrics::snapshot();
+    check(after.errors - before.errors == 3, "counters of live and exited threads are both kept");
+    check(after.read.count - before.read.count == 1, "histograms of exited threads are kept");
+    check(after.site_cache_hits - before.site_cache_hits == 1 && after.site_cache_misses - before.site_cache_misses == 1,
+          "site cache lookups count as hits or misses");
+}
+
+void prometheus() {
+    metrics::Snapshot s;
+    metrics::Histogram h;
+    h.record(2000000000);
+    s.eval[2].merge(h);
+    s.errors = 4;
+    s.site_cache_hits = 7;
+    const auto text = metrics::prometheus(s);
+    check(contains(text, "# TYPE zachlisp_eval_seconds summary"), "latencies are summaries");
+    check(text.find("zachlisp_eval_seconds{form=\"list\",quantile=\"0.5\"} 2.") != std::string::npos, "quantiles are in seconds");
+    check(contains(text, "zachlisp_eval_seconds_count{form=\"list\"} 1"), "summaries have a count");
+    check(text.find("form=\"vector\"") == std::string::npos, "form types with no samples are left out");
+    check(contains(text, "# TYPE zachlisp_errors_total counter") && contains(text, "zachlisp_errors_total 4"), "counters are exported");
+    check(contains(text, "zachlisp_site_cache_hits_total 7") && contains(text, "zachlisp_site_cache_misses_total 0"),
+          "site cache hits and misses are exported");
+}
+
+void exporter() {
+    const std::string path = "test_metrics.prom";
+    std::remove(path.c_str());
+    {
+        metrics::Exporter e(path, std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::ifstream in(path);
+        check(in.good(), "the exporter writes the file every interval");
+        metrics::local().exceptions.add(1);
+    }
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    check(contains(text.str(), "zachlisp_exceptions_total " + std::to_string(metrics::snapshot().exceptions)),
+          "the exporter writes the file once more when it stops");
+    std::ifstream tmp(path + ".tmp");
+    check(!tmp.good(), "the file is written through a temporary and renamed");
+    std::remove(path.c_str());
+}
+
+int main() {
+    buckets();
+    quantiles();
+    threads();
+    prometheus();
+    exporter();
+
+    if (failures == 0) {
+        std::cout << "metrics: all tests passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// tests for zachlisp::text on bytes a .mal test can't carry, since the test runner reads
+// its input and output as UTF-8. run with ./tests.sh text
+
+#include <iostream>
+#include <string>
+
+#include "../text.hpp"
+
+using zachlisp::text::Status;
+
+int failures = 0;
+
+void check(bool ok, const std::string & what) {
+    if (!ok) {
+        std::cout << "FAILED: " << what << "\n";
+        failures++;
+    }
+}
+
+// decodes body, as the reader does for the text between a literal's quotes
+Status unescape(const std::string & body, std::string & out, std::string & error) {
+    error.clear();
+    return zachlisp::text::unescape(body.data(), body.data() + body.size(), out, error);
+}
+
+void valid(const std::string & body, const std::string & expected, const std::string & what) {
+    std::string out, error;
+    check(unescape(body, out, error) == Status::OK && out == expected, what);
+}
+
+void invalid(const std::string & body, const std::string & message, const std::string & what) {
+    std::string out, error;
+    check(unescape(body, out, error) == Status::INVALID && error == message, what);
+}
+
+int main() {
+    valid("caf\xc3\xa9", "caf\xc3\xa9", "two-byte UTF-8 is copied through");
+    valid("\xe2\x82\xac\xf0\x9f\x98\x80", "\xe2\x82\xac\xf0\x9f\x98\x80", "three- and four-byte UTF-8 are copied through");
+    valid("\\ud83d\\ude00", "\xf0\x9f\x98\x80", "a surrogate pair decodes to one code point");
+    valid("\\u00e9\\u20AC", "\xc3\xa9\xe2\x82\xac", "\\u takes either case of hex digit");
+    // long enough for the 16-byte scan to find the escape and the non-ASCII byte in later blocks
+    valid(std::string(40, 'a') + "\\n" + std::string(20, 'b') + "\xc3\xa9", std::string(40, 'a') + "\n" + std::string(20, 'b') + "\xc3\xa9",
+          "escapes and UTF-8 past the first block");
+
+    const std::string bad = "Invalid UTF-8 in string";
+    invalid("a\xff", bad, "0xff is never UTF-8");
+    invalid("\x80", bad, "a continuation byte can't start a sequence");
+    invalid("\xc0\xaf", bad, "overlong two-byte forms are rejected");
+    invalid("\xe0\x80\xaf", bad, "overlong three-byte forms are rejected");
+    invalid("\xed\xa0\x80", bad, "encoded surrogates are rejected");
+    invalid("\xf4\x90\x80\x80", bad, "code points past U+10FFFF are rejected");
+    invalid("\xe2\x82", bad, "a truncated sequence is rejected");
+    invalid(std::string(30, 'a') + "\xe2\x82" + "a", bad, "a truncated sequence in a later block is rejected");
+
+    invalid("\\ud83d", "Unpaired surrogate in string", "a lone high surrogate is rejected");
+    invalid("\\ud83d\\u0041", "Unpaired surrogate in string", "a high surrogate needs a low one after it");
+    invalid("\\ude00", "Unpaired surrogate in string", "a lone low surrogate is rejected");
+
+    std::string out, error;
+    check(unescape("abc\\", out, error) == Status::UNTERMINATED, "an escaped closing quote leaves the literal open");
+
+    if (failures == 0) {
+        std::cout << "text: all tests passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace zachlisp {
+
+    // zachlisp::text
+    // decoding string literals. the body of a literal is scanned 16 bytes at a time for
+    // backslashes and non-ASCII bytes; only escapes and multi-byte UTF-8 sequences are
+    // looked at one byte at a time, and everything between escapes is copied whole
+    namespace text {
+
+    enum class Status {OK, INVALID, UNTERMINATED};
+
+    inline void append_utf8(std::string & out, std::uint32_t c) {
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xc0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xe0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        }
+    }
+
+    // the length of the well-formed UTF-8 sequence at p, which starts with a non-ASCII
+    // byte, or 0 if it is malformed, overlong, a surrogate or past U+10FFFF
+    inline std::size_t utf8_length(const unsigned char* p, const unsigned char* last) {
+        auto continuation = [&](std::size_t i, unsigned char lo = 0x80, unsigned char hi = 0xbf) {
+            return p + i < last && p[i] >= lo && p[i] <= hi;
+        };
+        const unsigned char c = p[0];
+        if (c >= 0xc2 && c <= 0xdf) {
+            return continuation(1) ? 2 : 0;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            const unsigned char lo = c == 0xe0 ? 0xa0 : 0x80;
+            const unsigned char hi = c == 0xed ? 0x9f : 0xbf;
+            return continuation(1, lo, hi) && continuation(2) ? 3 : 0;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            const unsigned char lo = c == 0xf0 ? 0x90 : 0x80;
+            const unsigned char hi = c == 0xf4 ? 0x8f : 0xbf;
+            return continuation(1, lo, hi) && continuation(2) && continuation(3) ? 4 : 0;
+        }
+        return 0;
+    }
+
+    inline int hex_digit(unsigned char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // reads the four hex digits of a \u escape at p, or returns false
+    inline bool read_hex4(const unsigned char* p, const unsigned char* last, std::uint32_t & c) {
+        if (last - p < 4) {
+            return false;
+        }
+        c = 0;
+        for (int i = 0; i < 4; i++) {
+            const int d = hex_digit(p[i]);
+            if (d < 0) {
+                return false;
+            }
+            c = c * 16 + d;
+        }
+        return true;
+    }
+
+    // how many bytes from p, up to last, are ASCII other than a backslash
+    inline std::size_t clean_run(const unsigned char* p, const unsigned char* last) {
+        const unsigned char* start = p;
+#if defined(__SSE2__)
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (last - p >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // the high bit of each byte marks non-ASCII, which movemask reads directly
+            const int mask = _mm_movemask_epi8(_mm_or_si128(chunk, _mm_cmpeq_epi8(chunk, backslash)));
+            if (mask != 0) {
+                return (p - start) + __builtin_ctz(mask);
+            }
+            p += 16;
+        }
+#endif
+        while (p < last && *p < 0x80 && *p != '\\') {
+            ++p;
+        }
+        return p - start;
+    }
+
+    // decodes the body of a string literal, the text between its quotes, into out.
+    // on failure error says why. UNTERMINATED means the closing quote was escaped
+    inline Status unescape(const char* first, const char* last, std::string & out, std::string & error) {
+        auto p = reinterpret_cast<const unsigned char*>(first);
+        auto end = reinterpret_cast<const unsigned char*>(last);
+        out.clear();
+        out.reserve(end - p);
+        // the start of the bytes that have been checked but not yet copied
+        auto pending = p;
+        while (p < end) {
+            p += clean_run(p, end);
+            if (p == end) {
+                break;
+            }
+            if (*p >= 0x80) {
+                const std::size_t n = utf8_length(p, end);
+                if (n == 0) {
+                    error = "Invalid UTF-8 in string";
+                    return Status::INVALID;
+                }
+                p += n;
+                continue;
+            }
+            out.append(reinterpret_cast<const char*>(pending), p - pending);
+            if (p + 1 == end) {
+                return Status::UNTERMINATED;
+            }
+            switch (p[1]) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case 'u':
+                    {
+                        std::uint32_t c;
+                        if (!read_hex4(p + 2, end, c)) {
+                            error = "Invalid \\u escape in string";
+                            return Status::INVALID;
+                        }
+                        p += 4;
+                        if (c >= 0xd800 && c <= 0xdbff) {
+                            // a high surrogate has to be followed by an escaped low surrogate
+                            std::uint32_t low;
+                            if (end - p < 8 || p[2] != '\\' || p[3] != 'u' || !read_hex4(p + 4, end, low) || low < 0xdc00 || low > 0xdfff) {
+                                error = "Unpaired surrogate in string";
+                                return Status::INVALID;
+                            }
+                            c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                            p += 6;
+                        } else if (c >= 0xdc00 && c <= 0xdfff) {
+                            error = "Unpaired surrogate in string";
+                            return Status::INVALID;
+                        }
+                        append_utf8(out, c);
+                        break;
+                    }
+                default:
+                    error = "Unsupported escape in string: \\" + std::string(1, static_cast<char>(p[1]));
+                    return Status::INVALID;
+            }
+            p += 2;
+            pending = p;
+        }
+        out.append(reinterpret_cast<const char*>(pending), p - pending);
+        return Status::OK;
+    }
+
+    // the inverse for printing: quotes, backslashes and the control characters that
+    // unescape decodes are escaped again, everything else is copied through
+    inline std::string escape(const std::string & s) {
+        std::string out;
+        out.reserve(s.size() + 2);
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                case '\r': out += "\\r"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default: out += c;
+            }
+        }
+        return out;
+    }
+
+    }
+
+}